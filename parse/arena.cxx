@@ -0,0 +1,79 @@
+#include "arena.hxx"
+
+#include <cstdlib>
+
+namespace dasl {
+
+Arena::Arena() {}
+
+Arena::~Arena() { clear(); }
+
+void *Arena::allocate_slow(std::size_t size, std::size_t align) {
+  // Oversized requests get a block of their own so the current block keeps
+  // its remaining space.
+  if (size + align > BLOCK_SIZE) {
+    char *data = static_cast<char *>(std::malloc(size + align));
+    if (data == nullptr) throw std::bad_alloc();
+    large.push_back({ data, size + align });
+
+    std::size_t pad = (align - reinterpret_cast<std::size_t>(data) % align) % align;
+    used += size + pad;
+    return data + pad;
+  }
+
+  std::size_t next = cursor ? current + 1 : 0;
+  if (next == blocks.size()) {
+    char *data = static_cast<char *>(std::malloc(BLOCK_SIZE));
+    if (data == nullptr) throw std::bad_alloc();
+    blocks.push_back({ data, BLOCK_SIZE });
+  }
+
+  current = next;
+  cursor = blocks[current].data;
+  limit = cursor + blocks[current].size;
+  return allocate(size, align);
+}
+
+void Arena::release(const Mark &m) {
+  for (std::size_t i = finalizers.size(); i > m.finalizers; i--)
+    finalizers[i - 1].destroy(finalizers[i - 1].obj);
+  finalizers.resize(m.finalizers);
+
+  for (std::size_t i = m.large; i < large.size(); i++)
+    std::free(large[i].data);
+  large.resize(m.large);
+
+  current = m.current;
+  cursor = m.cursor;
+  limit = cursor ? blocks[current].data + blocks[current].size : nullptr;
+  used = m.used;
+}
+
+void Arena::adopt(Arena &other) {
+  // Adopted blocks are kept with the oversized ones, which are freed one by
+  // one when released; bumping carries on in this arena's own blocks.
+  std::size_t used_blocks = other.cursor ? other.current + 1 : 0;
+  large.insert(large.end(), other.blocks.begin(), other.blocks.begin() + used_blocks);
+  for (std::size_t i = used_blocks; i < other.blocks.size(); i++)
+    std::free(other.blocks[i].data);
+  large.insert(large.end(), other.large.begin(), other.large.end());
+  finalizers.insert(finalizers.end(), other.finalizers.begin(), other.finalizers.end());
+  used += other.used;
+
+  other.blocks.clear();
+  other.large.clear();
+  other.finalizers.clear();
+  other.current = 0;
+  other.cursor = other.limit = nullptr;
+  other.used = 0;
+}
+
+void Arena::clear() {
+  release(Mark { 0, nullptr, 0, 0, 0 });
+
+  for (auto it = blocks.begin(); it != blocks.end(); it++)
+    std::free(it->data);
+  blocks.clear();
+}
+
+} // namespace dasl
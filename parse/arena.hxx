@@ -0,0 +1,97 @@
+#ifndef ARENA_HXX
+#define ARENA_HXX
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dasl {
+
+// Bump allocator. Objects are placed in large blocks and are never freed
+// individually; everything is released at once when the arena is destroyed,
+// or rolled back to an earlier mark().
+// Destructors of non-trivial objects are run in reverse order of creation, in
+// a flat loop, so tearing down a deep tree never recurses.
+class Arena {
+  static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+  struct Block {
+    char *data;
+    std::size_t size;
+  };
+
+  struct Finalizer {
+    void *obj;
+    void (*destroy)(void *);
+  };
+
+  // Regular blocks are kept around after a release() and reused; `current`
+  // is the one being bumped into, if any. Oversized requests live in `large`.
+  std::vector<Block> blocks;
+  std::vector<Block> large;
+  std::vector<Finalizer> finalizers;
+  std::size_t current = 0;
+  char *cursor = nullptr;
+  char *limit = nullptr;
+  std::size_t used = 0;
+
+  void *allocate_slow(std::size_t size, std::size_t align);
+
+ public:
+  Arena();
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  ~Arena();
+
+  void *allocate(std::size_t size, std::size_t align) {
+    std::size_t pad = (align - reinterpret_cast<std::size_t>(cursor) % align) % align;
+    if (cursor && static_cast<std::size_t>(limit - cursor) >= size + pad) {
+      char *p = cursor + pad;
+      cursor = p + size;
+      used += size + pad;
+      return p;
+    }
+    return allocate_slow(size, align);
+  }
+
+  template <typename T, typename... Args>
+  T *make(Args &&... args) {
+    void *mem = allocate(sizeof(T), alignof(T));
+    T *obj = new (mem) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>)
+      finalizers.push_back({obj, [](void *p) { static_cast<T *>(p)->~T(); }});
+    return obj;
+  }
+
+  // A point in the allocation history that release() can roll back to.
+  struct Mark {
+    std::size_t current;
+    char *cursor;
+    std::size_t large;
+    std::size_t finalizers;
+    std::size_t used;
+  };
+
+  Mark mark() const { return { current, cursor, large.size(), finalizers.size(), used }; }
+
+  // Destroys everything allocated since `m` was taken and makes its memory
+  // available again. Objects allocated before the mark are untouched.
+  void release(const Mark &m);
+
+  // Runs every pending destructor and returns all memory.
+  void clear();
+
+  // Takes over everything allocated from `other`, which is left empty.
+  // The objects stay where they are and are destroyed with this arena, or by
+  // a release() to a mark taken before the call.
+  void adopt(Arena &other);
+
+  // Bytes handed out so far, including alignment padding.
+  std::size_t bytes_used() const { return used; }
+};
+
+} // namespace dasl
+
+#endif // ARENA_HXX
@@ -0,0 +1,333 @@
+#include "ast_file.hxx"
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "parse_tree.hxx"
+
+namespace dasl::pt {
+
+static const char AST_MAGIC[4] = { 'D', 'A', 'S', 'T' };
+static const uint32_t AST_BYTE_ORDER = 0x01020304;
+
+struct AstHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t nodes;
+  uint32_t children;
+  uint32_t literals;
+  uint32_t statements;
+  uint32_t strings;
+  uint32_t string_bytes;
+  uint32_t source_bytes;
+};
+
+// Byte offsets of the sections that follow the header. Writer and reader
+// both derive them from the counts in the header.
+struct AstLayout {
+  size_t kinds, ops, data, first_child, child_count, spans, children, literals, statements;
+  size_t string_offsets, string_bytes, source, size;
+
+  explicit AstLayout(const AstHeader &h) {
+    size_t at = sizeof(AstHeader);
+    auto section = [&at](size_t bytes) {
+      size_t start = (at + 7) & ~size_t(7);
+      at = start + bytes;
+      return start;
+    };
+    kinds = section(h.nodes * sizeof(NodeKind));
+    ops = section(h.nodes);
+    data = section(h.nodes * sizeof(uint32_t));
+    first_child = section(h.nodes * sizeof(uint32_t));
+    child_count = section(h.nodes * sizeof(uint32_t));
+    spans = section(h.nodes * sizeof(Span));
+    children = section(h.children * sizeof(NodeId));
+    literals = section(h.literals * sizeof(uint64_t));
+    statements = section(h.statements * sizeof(NodeId));
+    string_offsets = section((size_t(h.strings) + 1) * sizeof(uint32_t));
+    string_bytes = section(h.string_bytes);
+    source = section(h.source_bytes);
+    size = at;
+  }
+};
+
+// Checks that everything a reader follows from the header on stays inside
+// the file: every node has the children its kind is printed with, of the
+// kinds expected there, and refers to strings, literals and children that
+// exist. Children come before their parents, as FlatTree appends them, so
+// the tree has no cycles.
+class AstChecker {
+  const FlatView &t;
+  const AstHeader &h;
+
+  static bool in(NodeKind k, NodeKind first, NodeKind last) { return k >= first && k <= last; }
+  static bool type(NodeKind k) { return in(k, NodeKind::LIST_TYPE, NodeKind::PRIM_TYPE); }
+  static bool pat(NodeKind k) { return in(k, NodeKind::LIST_PAT, NodeKind::VALUE_PAT); }
+  static bool expr(NodeKind k) { return in(k, NodeKind::IF_ELSE_EXPR, NodeKind::COMPOUND_EXPR); }
+  static bool st(NodeKind k) { return in(k, NodeKind::DEF_ST, NodeKind::EXPR_ST); }
+
+  NodeKind kind(NodeId n) const { return t.kinds[n]; }
+  uint32_t count(NodeId n) const { return t.child_count[n]; }
+  bool named(NodeId n) const { return t.data[n] < h.strings; }
+
+  // Children [from, count) of `n` are all of kind `is`.
+  template <typename Is>
+  bool all(NodeId n, uint32_t from, Is &&is) const {
+    for (uint32_t i = from; i < count(n); i++)
+      if (!is(kind(t.child(n, i)))) return false;
+    return true;
+  }
+  // Children [from, count) of `n` are FIELD (or CASE) nodes whose child
+  // `i` is of kind `is`.
+  template <typename Is>
+  bool wrapped(NodeId n, uint32_t from, NodeKind wrapper, uint32_t i, Is &&is) const {
+    for (uint32_t j = from; j < count(n); j++) {
+      NodeId c = t.child(n, j);
+      if (kind(c) != wrapper || !is(kind(t.child(c, i)))) return false;
+    }
+    return true;
+  }
+  bool seq(NodeId n, bool (*is)(NodeKind)) const { return kind(n) == NodeKind::SEQ && all(n, 0, is); }
+  bool symbol(NodeId n) const { return kind(n) == NodeKind::SYMBOL; }
+
+  bool value(NodeId n) const {
+    switch (t.ops[n]) {
+      case STRING:
+      case ATOM: return named(n);
+      case INT:
+      case FLOAT: return t.data[n] < h.literals;
+      case UNIT:
+      case BOOL: return true;
+      default: return false;
+    }
+  }
+
+  // A list: [type, items...] and the tail after them.
+  bool list(NodeId n, bool (*is)(NodeKind)) const {
+    return count(n) >= 1 + (t.ops[n] & HAS_TAIL) && all(n, 1, is);
+  }
+  bool map(NodeId n, bool (*is)(NodeKind)) const { return count(n) % 2 == 1 && all(n, 1, is); }
+
+  // The node itself, given that its children are well formed.
+  bool shape(NodeId n) const {
+    uint32_t k = count(n);
+    switch (kind(n)) {
+      case NodeKind::LIST_TYPE:
+      case NodeKind::MAP_TYPE:
+      case NodeKind::ANY_TYPE: return k == 0;
+      case NodeKind::PRIM_TYPE: return k == 0 && t.ops[n] <= PrimType::UNIT;
+      case NodeKind::RECORD_TYPE: return k == 1 && symbol(t.child(n, 0));
+
+      case NodeKind::LIST_PAT: return list(n, pat);
+      case NodeKind::MAP_PAT: return map(n, pat);
+      case NodeKind::RECORD_PAT: return k >= 2 && symbol(t.child(n, 1)) && wrapped(n, 2, NodeKind::FIELD, 0, pat);
+      case NodeKind::SYMBOL_PAT:
+      case NodeKind::SYMBOL_EXPR: return k == 2 && symbol(t.child(n, 1));
+      case NodeKind::VALUE_PAT:
+      case NodeKind::VALUE_EXPR: return k == 1 && value(n);
+
+      case NodeKind::IF_ELSE_EXPR:
+        return (k == 3 || k == 4) && expr(kind(t.child(n, 1))) && seq(t.child(n, 2), st) &&
+               (k == 3 || seq(t.child(n, 3), st));
+      case NodeKind::CASE_EXPR:
+        return k >= 2 && expr(kind(t.child(n, 1))) && wrapped(n, 2, NodeKind::CASE, 0, pat) &&
+               wrapped(n, 2, NodeKind::CASE, 1, expr);
+      case NodeKind::RECORD_EXPR: return k >= 2 && symbol(t.child(n, 1)) && wrapped(n, 2, NodeKind::FIELD, 0, expr);
+      case NodeKind::LIST_EXPR: return list(n, expr);
+      case NodeKind::MAP_EXPR: return map(n, expr);
+      case NodeKind::CALL_EXPR: return k >= 2 && symbol(t.child(n, 1)) && all(n, 2, expr);
+      case NodeKind::BIN_OP_EXPR: return k == 3 && t.ops[n] <= BinOpExpr::LTE && all(n, 1, expr);
+      case NodeKind::UN_OP_EXPR: return k == 2 && t.ops[n] <= UnOpExpr::NEG && all(n, 1, expr);
+      case NodeKind::COMPOUND_EXPR: return k >= 1 && all(n, 1, expr);
+
+      case NodeKind::DEF_ST:
+        return k == 3 && named(n) && seq(t.child(n, 1), pat) && seq(t.child(n, 2), st);
+      case NodeKind::RECORD_ST: return named(n) && wrapped(n, 0, NodeKind::FIELD, 0, type);
+      case NodeKind::VAL_ST: return k == 1 && named(n) && all(n, 0, expr);
+      case NodeKind::MODULE_ST: return named(n) && all(n, 0, st);
+      case NodeKind::EXPR_ST: return k == 1 && all(n, 0, expr);
+
+      case NodeKind::SYMBOL: return named(n) && all(n, 0, [](NodeKind c) { return c == NodeKind::ID; });
+      case NodeKind::ID: return k == 0 && named(n);
+      case NodeKind::FIELD: return k == 1 && named(n);
+      case NodeKind::CASE: return k == 2;
+      case NodeKind::SEQ: return true;
+      default: return false;
+    }
+  }
+
+  // Child 0 of patterns, expressions and defs is an optional type.
+  bool optional_type(NodeId n) const {
+    return pat(kind(n)) || expr(kind(n)) || kind(n) == NodeKind::DEF_ST;
+  }
+
+ public:
+  AstChecker(const FlatView &t, const AstHeader &h) : t(t), h(h) {}
+
+  bool check() const {
+    for (uint32_t i = 0; i < h.strings; i++)
+      if (t.string_offsets[i] > t.string_offsets[i + 1]) return false;
+    if (t.string_offsets[h.strings] != h.string_bytes) return false;
+
+    for (NodeId n = 0; n < t.nodes; n++) {
+      if (uint64_t(t.first_child[n]) + t.child_count[n] > h.children) return false;
+      for (uint32_t i = 0; i < count(n); i++) {
+        NodeId c = t.child(n, i);
+        if (c == NO_NODE && i == 0 && optional_type(n)) continue;
+        if (c >= n) return false;
+      }
+      if (optional_type(n) && count(n) > 0 && t.child(n, 0) != NO_NODE && !type(kind(t.child(n, 0)))) return false;
+      if (!shape(n)) return false;
+    }
+    for (uint32_t i = 0; i < t.statement_count; i++)
+      if (t.statements[i] >= t.nodes || !st(kind(t.statements[i]))) return false;
+    return true;
+  }
+};
+
+static bool has_string(const FlatTree &tree, NodeId n) {
+  switch (tree.kinds[n]) {
+    case NodeKind::SYMBOL:
+    case NodeKind::ID:
+    case NodeKind::FIELD:
+    case NodeKind::DEF_ST:
+    case NodeKind::RECORD_ST:
+    case NodeKind::VAL_ST:
+    case NodeKind::MODULE_ST:
+      return true;
+    case NodeKind::VALUE_PAT:
+    case NodeKind::VALUE_EXPR:
+      return tree.ops[n] == STRING || tree.ops[n] == ATOM;
+    default:
+      return false;
+  }
+}
+
+template <typename T>
+static void put(vector<char> &out, size_t offset, const T *items, size_t count) {
+  if (count) std::memcpy(out.data() + offset, items, count * sizeof(T));
+}
+
+vector<char> serialize_ast(const FlatTree &tree, const Interner &interner, const string &source_name) {
+  // Renumber strings in order of first use, in the same pass that rewrites
+  // `data`.
+  std::unordered_map<uint32_t, uint32_t> ids;
+  vector<uint32_t> data(tree.data);
+  vector<uint32_t> offsets{ 0 };
+  string bytes;
+  for (NodeId n = 0; n < tree.size(); n++) {
+    if (!has_string(tree, n)) continue;
+    auto it = ids.try_emplace(tree.data[n], offsets.size() - 1);
+    if (it.second) {
+      bytes += interner.get_string(istring{ tree.data[n] });
+      offsets.push_back(bytes.size());
+    }
+    data[n] = it.first->second;
+  }
+
+  AstHeader h;
+  std::memcpy(h.magic, AST_MAGIC, sizeof AST_MAGIC);
+  h.version = AST_FILE_VERSION;
+  h.byte_order = AST_BYTE_ORDER;
+  h.nodes = tree.size();
+  h.children = tree.children.size();
+  h.literals = tree.literals.size();
+  h.statements = tree.statements.size();
+  h.strings = offsets.size() - 1;
+  h.string_bytes = bytes.size();
+  h.source_bytes = source_name.size();
+
+  AstLayout l(h);
+  vector<char> out(l.size);
+  put(out, 0, &h, 1);
+  put(out, l.kinds, tree.kinds.data(), h.nodes);
+  put(out, l.ops, tree.ops.data(), h.nodes);
+  put(out, l.data, data.data(), h.nodes);
+  put(out, l.first_child, tree.first_child.data(), h.nodes);
+  put(out, l.child_count, tree.child_count.data(), h.nodes);
+  put(out, l.spans, tree.spans.data(), h.nodes);
+  put(out, l.children, tree.children.data(), h.children);
+  put(out, l.literals, tree.literals.data(), h.literals);
+  put(out, l.statements, tree.statements.data(), h.statements);
+  put(out, l.string_offsets, offsets.data(), offsets.size());
+  put(out, l.string_bytes, bytes.data(), bytes.size());
+  put(out, l.source, source_name.data(), source_name.size());
+  return out;
+}
+
+bool write_ast_file(const string &path, const FlatTree &tree, const Interner &interner,
+                    const string &source_name) {
+  vector<char> out = serialize_ast(tree, interner, source_name);
+  FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) return false;
+  bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+  return std::fclose(f) == 0 && ok;
+}
+
+bool AstFile::open(const string &path) {
+  tree = FlatView();
+  source = string_view();
+  children = literals = strings = 0;
+  if (!file.open(path)) return false;
+
+  string_view bytes = file.view();
+  AstHeader h;
+  if (bytes.size() < sizeof h) return false;
+  std::memcpy(&h, bytes.data(), sizeof h);
+  if (std::memcmp(h.magic, AST_MAGIC, sizeof AST_MAGIC) != 0 || h.version != AST_FILE_VERSION ||
+      h.byte_order != AST_BYTE_ORDER)
+    return false;
+
+  AstLayout l(h);
+  if (bytes.size() < l.size) return false;
+
+  const char *base = bytes.data();
+  tree.kinds = reinterpret_cast<const NodeKind *>(base + l.kinds);
+  tree.ops = reinterpret_cast<const uint8_t *>(base + l.ops);
+  tree.data = reinterpret_cast<const uint32_t *>(base + l.data);
+  tree.first_child = reinterpret_cast<const uint32_t *>(base + l.first_child);
+  tree.child_count = reinterpret_cast<const uint32_t *>(base + l.child_count);
+  tree.spans = reinterpret_cast<const Span *>(base + l.spans);
+  tree.nodes = h.nodes;
+  tree.children = reinterpret_cast<const NodeId *>(base + l.children);
+  tree.literals = reinterpret_cast<const uint64_t *>(base + l.literals);
+  tree.statements = reinterpret_cast<const NodeId *>(base + l.statements);
+  tree.statement_count = h.statements;
+  tree.string_offsets = reinterpret_cast<const uint32_t *>(base + l.string_offsets);
+  tree.string_bytes = base + l.string_bytes;
+  source = string_view(base + l.source, h.source_bytes);
+
+  if (!AstChecker(tree, h).check()) {
+    tree = FlatView();
+    return false;
+  }
+  children = h.children;
+  literals = h.literals;
+  strings = h.strings;
+  return true;
+}
+
+void AstFile::intern(Interner &interner, FlatTree &out) const {
+  out.kinds.assign(tree.kinds, tree.kinds + tree.nodes);
+  out.ops.assign(tree.ops, tree.ops + tree.nodes);
+  out.data.assign(tree.data, tree.data + tree.nodes);
+  out.first_child.assign(tree.first_child, tree.first_child + tree.nodes);
+  out.child_count.assign(tree.child_count, tree.child_count + tree.nodes);
+  out.spans.assign(tree.spans, tree.spans + tree.nodes);
+  out.children.assign(tree.children, tree.children + children);
+  out.literals.assign(tree.literals, tree.literals + literals);
+  out.statements.assign(tree.statements, tree.statements + tree.statement_count);
+
+  // Strings of the file are interned once each.
+  vector<uint32_t> ids(strings, NO_NODE);
+  for (NodeId n = 0; n < out.size(); n++) {
+    if (!has_string(out, n)) continue;
+    uint32_t &id = ids[out.data[n]];
+    if (id == NO_NODE) id = interner.get(tree.str(out.data[n])).i;
+    out.data[n] = id;
+  }
+}
+
+} // namespace dasl::pt
@@ -0,0 +1,59 @@
+#ifndef AST_FILE_HXX
+#define AST_FILE_HXX
+
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "flat_tree.hxx"
+#include "mapped_file.hxx"
+
+namespace dasl::pt {
+
+// Binary form of a FlatTree. The file is a fixed header followed by the
+// tree's arrays, each 8 byte aligned and in native byte order, and a table
+// of the strings the tree refers to. String ids in the file index that
+// table, so a file does not depend on the Interner it was written from.
+//
+// Bump the version whenever NodeKind, the child layouts or the file layout
+// change; files from other versions are rejected rather than misread.
+constexpr uint32_t AST_FILE_VERSION = 2;
+
+// Serializes `tree`, whose strings belong to `interner`. `source_name` is
+// stored for diagnostics.
+vector<char> serialize_ast(const FlatTree &tree, const Interner &interner, const string &source_name);
+
+// Writes serialize_ast() to `path`. Returns false if the file could not be
+// written.
+bool write_ast_file(const string &path, const FlatTree &tree, const Interner &interner,
+                    const string &source_name);
+
+// A serialized tree loaded by mapping the file. The view points straight
+// into the mapping, so nothing is copied; loading only checks each node
+// once.
+class AstFile {
+  MappedFile file;
+  FlatView tree;
+  string_view source;
+  // Sizes of the arrays the view has no count for.
+  uint32_t children = 0, literals = 0, strings = 0;
+
+ public:
+  // Returns false if the file is missing, truncated, from another version,
+  // was written on a machine with a different byte order or is not a well
+  // formed tree, so the view never leads outside the file.
+  bool open(const string &path);
+
+  const FlatView &view() const { return tree; }
+  // Copies the tree into `out` with its strings interned in `interner`, so
+  // it can be used like a tree just flattened from a program parsed with it.
+  void intern(Interner &interner, FlatTree &out) const;
+  // The whole file, as serialize_ast() produced it.
+  string_view bytes() const { return file.view(); }
+  string_view source_name() const { return source; }
+};
+
+} // namespace dasl::pt
+
+#endif // AST_FILE_HXX
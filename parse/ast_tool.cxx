@@ -0,0 +1,369 @@
+#include <string>
+using std::string;
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+using std::vector;
+
+#include "ast_file.hxx"
+#include "driver.hxx"
+#include "hash_cons.hxx"
+#include "layout.hxx"
+#include "match.hxx"
+#include "resolve.hxx"
+#include "visit.hxx"
+#include "work_pool.hxx"
+
+using dasl::pt::Env;
+
+// Writes, prints and checks serialized trees (see ast_file.hxx).
+//
+//   ast write in.dzl out.dast   parse a program and serialize it
+//   ast print in.dast           print a serialized program
+//   ast check in.dzl            round trip through a temporary file and
+//                               compare with Program::to_string
+//   ast walk in.dzl             check that walk and walk_iterative visit the
+//                               same nodes as the flat tree holds
+//   ast match in.dzl            print the decision tree of every case and
+//                               the arms it finds unreachable or missing
+//   ast share in.dzl            check that sharing equal subtrees does not
+//                               change the program and leaves one node per
+//                               distinct type
+//   ast resolve in.dzl          print the scopes, the bindings and what every
+//                               name refers to, after checking that parsing
+//                               and resolving on several threads gives the
+//                               same
+//   ast layout in.dzl           print the layout of every record and the slot
+//                               of every field access compiled to one
+
+static void usage() {
+  std::cout << "usage: ast write in.dzl out.dast | ast print in.dast | ast check in.dzl | ast walk in.dzl | ast match in.dzl | ast share in.dzl | ast resolve in.dzl | ast layout in.dzl"
+            << std::endl;
+}
+
+static bool parse(const string &path, Env &env) {
+  dasl::MappedFile source;
+  if (!source.open(path)) {
+    std::cout << "Failed to read file " << path << std::endl;
+    return false;
+  }
+  bool ok = dasl::parse_source(source.view(), env, &path);
+  for (auto it = env.errors.begin(); it != env.errors.end(); it++)
+    dasl::print_diagnostic(std::cout, *it, env.lines);
+  if (!ok) std::cout << "FAILED TO PARSE!" << std::endl;
+  return ok;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int check(const string &path) {
+  Env env;
+  auto start = std::chrono::steady_clock::now();
+  if (!parse(path, env)) return 1;
+  double parse_time = seconds_since(start);
+
+  string expected = env.pt->to_string(env);
+
+  string tmp = path + ".dast.tmp";
+  dasl::pt::FlatTree tree(*env.pt);
+  if (!dasl::pt::write_ast_file(tmp, tree, env.interner, path)) {
+    std::cout << "Failed to write " << tmp << std::endl;
+    return 1;
+  }
+
+  dasl::pt::AstFile file;
+  start = std::chrono::steady_clock::now();
+  bool loaded = file.open(tmp);
+  double load_time = seconds_since(start);
+  std::remove(tmp.c_str());
+  if (!loaded) {
+    std::cout << "Failed to load " << tmp << std::endl;
+    return 1;
+  }
+
+  dasl::pt::Printer printer;
+  dasl::pt::print(file.view(), printer);
+  if (printer.take() != expected || file.source_name() != path) {
+    std::cout << "Failed round trip " << path << std::endl;
+    return 1;
+  }
+  std::cout << "Passed round trip " << path << " (parse " << parse_time << "s, load " << load_time << "s)"
+            << std::endl;
+  return 0;
+}
+
+static int walk(const string &path) {
+  using dasl::pt::NodeKind;
+  using dasl::pt::PT;
+
+  Env env;
+  if (!parse(path, env)) return 1;
+
+  // Both walkers must produce the same enter/leave sequence.
+  vector<const PT *> recursive, iterative;
+  const dasl::pt::Program *program = env.pt;
+  dasl::pt::walk(program, [&](const PT &n) { recursive.push_back(&n); return true; },
+                 [&](const PT &n) { recursive.push_back(nullptr); });
+  dasl::pt::walk_iterative(program, [&](const PT &n) { iterative.push_back(&n); return true; },
+                           [&](const PT &n) { iterative.push_back(nullptr); });
+
+  // Every node visited must be in the flat tree, which also holds the
+  // helper nodes (ids, symbols, fields...) that are not PT nodes.
+  long counts[size_t(NodeKind::NONE) + 1] = {};
+  for (auto it = recursive.begin(); it != recursive.end(); it++)
+    if (*it) counts[size_t((*it)->tag)]++;
+  dasl::pt::FlatTree tree(*env.pt);
+  for (auto it = tree.kinds.begin(); it != tree.kinds.end(); it++)
+    counts[size_t(*it)]--;
+
+  bool ok = recursive == iterative && counts[size_t(NodeKind::PROGRAM)] == 1;
+  for (size_t k = 0; k < size_t(NodeKind::SYMBOL); k++)
+    ok = ok && counts[k] == 0;
+  if (!ok) {
+    std::cout << "Failed walk " << path << std::endl;
+    return 1;
+  }
+  std::cout << "Passed walk " << path << " (" << recursive.size() / 2 << " nodes)" << std::endl;
+  return 0;
+}
+
+static int match(const string &path) {
+  using dasl::pt::CaseExpr;
+  using dasl::pt::PT;
+
+  Env env;
+  if (!parse(path, env)) return 1;
+
+  dasl::pt::Printer printer(env.interner, std::cout);
+  dasl::pt::walk_iterative(static_cast<const PT *>(env.pt), [&](const PT &n) {
+    auto *expr = dasl::pt::node_cast<CaseExpr>(&n);
+    if (!expr) return true;
+    dasl::LineTable::Position at = env.lines.position(expr->span.begin);
+    printer << "case at " << uint64_t(at.line) << ':' << uint64_t(at.column) << '\n';
+    dasl::pt::MatchTree tree;
+    if (dasl::pt::compile_match(*expr, tree)) dasl::pt::print(tree, printer);
+    else printer << "too large\n";
+    return true;
+  });
+  printer.flush();
+
+  vector<dasl::pt::Diagnostic> warnings;
+  dasl::pt::check_matches(*env.pt, warnings);
+  for (auto it = warnings.begin(); it != warnings.end(); it++)
+    dasl::print_diagnostic(std::cout, *it, env.lines);
+  return 0;
+}
+
+static int share(const string &path) {
+  using dasl::pt::PT;
+
+  Env env;
+  if (!parse(path, env)) return 1;
+  string expected = env.pt->to_string(env);
+
+  // Types shared while parsing, the rest afterwards.
+  dasl::pt::HashCons table;
+  Env shared;
+  shared.shared_types = &table;
+  if (!parse(path, shared)) return 1;
+  dasl::pt::ShareStats stats = dasl::pt::share_subtrees(*shared.pt, table);
+  size_t canonical = table.size();
+  dasl::pt::ShareStats again = dasl::pt::share_subtrees(*shared.pt, table);
+  // A tree already shared through one table is shared again through another
+  // from scratch, and ends up with every node canonical in both.
+  dasl::pt::HashCons other;
+  dasl::pt::ShareStats moved = dasl::pt::share_subtrees(*shared.pt, other);
+
+  // Types print the same exactly when they are equal.
+  std::unordered_map<string, const PT *> types;
+  bool unique = true;
+  dasl::pt::walk_iterative(static_cast<const PT *>(shared.pt), [&](const PT &n) {
+    if (n.tag <= dasl::pt::NodeKind::PRIM_TYPE) {
+      auto it = types.emplace(n.to_string(shared), &n).first;
+      unique = unique && it->second == &n;
+    }
+    return true;
+  });
+
+  if (shared.pt->to_string(shared) != expected || again.shared || table.size() != canonical || !unique ||
+      moved.shared || other.size() != canonical) {
+    std::cout << "Failed share " << path << std::endl;
+    return 1;
+  }
+  std::cout << "Passed share " << path << " (" << stats.shared << " of " << stats.slots << " slots shared, "
+            << canonical << " nodes)" << std::endl;
+  return 0;
+}
+
+static string resolution_text(Env &env, const dasl::pt::Resolution &r) {
+  using namespace dasl::pt;
+  static const char *scope_kinds[] = { "module", "def", "block", "arm" };
+  static const char *binding_kinds[] = { "val", "def", "type", "module", "pat" };
+
+  Printer p(env.interner);
+  auto at = [&](Span span) {
+    dasl::LineTable::Position pos = env.lines.position(span.begin);
+    p << uint64_t(pos.line) << ':' << uint64_t(pos.column);
+  };
+  for (size_t i = 0; i < r.scopes.size(); i++) {
+    const Scope &s = r.scopes[i];
+    p << "scope " << uint64_t(i) << ' ' << scope_kinds[s.kind];
+    if (s.parent != NO_SCOPE) p << " in " << uint64_t(s.parent);
+    if (s.kind != Scope::MODULE) p << " [" << uint64_t(s.first) << ", " << uint64_t(s.end) << ')';
+    p << '\n';
+  }
+  for (size_t i = 0; i < r.bindings.size(); i++) {
+    const Binding &b = r.bindings[i];
+    p << "binding " << uint64_t(i) << ' ' << binding_kinds[b.kind] << ' ' << b.name << " at ";
+    at(b.node->span);
+    p << " in " << uint64_t(b.scope) << '\n';
+  }
+
+  auto ref = [&](const SymbolRef &symbol) {
+    if (symbol.target == NO_BINDING) return;
+    at(symbol.span);
+    p << ' ';
+    symbol.print(p);
+    p << " -> " << uint64_t(symbol.target) << '\n';
+  };
+  walk_iterative(static_cast<const PT *>(env.pt), [&](const PT &n) {
+    visit(n, [&](auto &node) {
+      using T = std::decay_t<decltype(node)>;
+      if constexpr (std::is_same_v<T, RecordType> || std::is_same_v<T, SymbolPat> || std::is_same_v<T, SymbolExpr>)
+        ref(node.symbol);
+      else if constexpr (std::is_same_v<T, RecordPat>)
+        ref(node.record_name);
+      else if constexpr (std::is_same_v<T, CallExpr> || std::is_same_v<T, RecordExpr>)
+        ref(node.name);
+    });
+    return true;
+  });
+  return p.take();
+}
+
+static int resolve(const string &path) {
+  Env env, parallel_env;
+  if (!parse(path, env)) return 1;
+  // The parallel tree is parsed in chunks with types shared, as parse -P
+  // does.
+  dasl::WorkPool pool(4);
+  dasl::MappedFile source;
+  dasl::pt::HashCons types;
+  parallel_env.shared_types = &types;
+  if (!source.open(path) || !dasl::parse_source_parallel(source.view(), parallel_env, pool, &path)) {
+    std::cout << "Failed parallel parse " << path << std::endl;
+    return 1;
+  }
+
+  dasl::pt::Resolution resolution, parallel;
+  dasl::pt::resolve(env, resolution);
+  dasl::pt::resolve(parallel_env, parallel, pool);
+
+  string text = resolution_text(env, resolution);
+  if (text != resolution_text(parallel_env, parallel)) {
+    std::cout << "Failed parallel resolve " << path << std::endl;
+    return 1;
+  }
+  std::cout << text;
+  for (auto it = resolution.errors.begin(); it != resolution.errors.end(); it++)
+    dasl::print_diagnostic(std::cout, *it, env.lines);
+  return 0;
+}
+
+static int layout(const string &path) {
+  using namespace dasl::pt;
+  Env env;
+  if (!parse(path, env)) return 1;
+  Resolution resolution;
+  dasl::pt::resolve(env, resolution);
+  Layouts layouts;
+  lay_out_records(env, resolution, layouts);
+
+  Printer p(env.interner);
+  for (auto it = layouts.records.begin(); it != layouts.records.end(); it++) {
+    p << "type " << it->record->name.val << ':';
+    for (size_t i = 0; i < it->size(); i++) p << ' ' << it->record->fields[i].first.val << ' ' << uint64_t(i);
+    p << '\n';
+  }
+
+  auto at = [&](Span span) {
+    dasl::LineTable::Position pos = env.lines.position(span.begin);
+    p << uint64_t(pos.line) << ':' << uint64_t(pos.column);
+  };
+  auto slots = [&](const SymbolRef &name, const auto &fields, const vector<uint32_t> &slots) {
+    name.print(p);
+    p << " {";
+    for (size_t i = 0; i < fields.size(); i++) {
+      p << ' ' << fields[i].first.val << " -> ";
+      if (slots[i] == NO_SLOT) p << '?';
+      else p << uint64_t(slots[i]);
+    }
+    p << " }\n";
+  };
+  walk_iterative(static_cast<const PT *>(env.pt), [&](const PT &n) {
+    if (auto *e = node_cast<RecordExpr>(&n)) {
+      if (e->slots.size() == e->fields.size() && e->name.target != NO_BINDING && layouts.find(e->name.target)) {
+        at(n.span);
+        p << ' ';
+        slots(e->name, e->fields, e->slots);
+      }
+    } else if (auto *r = node_cast<RecordPat>(&n)) {
+      if (r->slots.size() == r->fields.size() && r->record_name.target != NO_BINDING && layouts.find(r->record_name.target)) {
+        at(n.span);
+        p << ' ';
+        slots(r->record_name, r->fields, r->slots);
+      }
+    } else if (auto *b = node_cast<BinOpExpr>(&n)) {
+      if (b->slot != NO_SLOT) {
+        at(n.span);
+        p << " [";
+        b->rhs->print(p);
+        p << "] -> " << uint64_t(b->slot) << '\n';
+      }
+    }
+    return true;
+  });
+  std::cout << p.take();
+  for (auto it = layouts.errors.begin(); it != layouts.errors.end(); it++)
+    dasl::print_diagnostic(std::cout, *it, env.lines);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  string cmd = argc > 1 ? argv[1] : "";
+
+  if (cmd == "write" && argc == 4) {
+    Env env;
+    if (!parse(argv[2], env)) return 1;
+    dasl::pt::FlatTree tree(*env.pt);
+    if (!dasl::pt::write_ast_file(argv[3], tree, env.interner, argv[2])) {
+      std::cout << "Failed to write " << argv[3] << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  if (cmd == "print" && argc == 3) {
+    dasl::pt::AstFile file;
+    if (!file.open(argv[2])) {
+      std::cout << "Failed to load " << argv[2] << std::endl;
+      return 1;
+    }
+    dasl::pt::Printer printer(std::cout);
+    dasl::pt::print(file.view(), printer);
+    return 0;
+  }
+
+  if (cmd == "check" && argc == 3) return check(argv[2]);
+  if (cmd == "walk" && argc == 3) return walk(argv[2]);
+  if (cmd == "match" && argc == 3) return match(argv[2]);
+  if (cmd == "share" && argc == 3) return share(argv[2]);
+  if (cmd == "resolve" && argc == 3) return resolve(argv[2]);
+  if (cmd == "layout" && argc == 3) return layout(argv[2]);
+
+  usage();
+  return 1;
+}
@@ -0,0 +1,210 @@
+#include <string>
+using std::string;
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#include <vector>
+using std::vector;
+
+#include <sys/resource.h>
+
+#include "lexer.hxx"
+#include <parser.hxx>
+#include "driver.hxx"
+#include "layout.hxx"
+#include "resolve.hxx"
+#include "visit.hxx"
+#include "work_pool.hxx"
+
+using dasl::pt::Env;
+
+// Benchmarks the lexer, the parser, a tree walk and the printer on each input file and
+// prints one JSON object per file and phase, so results can be collected and
+// compared between builds. Times are the best of `-n` runs; allocation counts
+// are taken from the last run and include those of the WorkPool's threads.
+
+static std::atomic<size_t> allocations{ 0 };
+static std::atomic<size_t> allocated_bytes{ 0 };
+
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+struct Result {
+  const char *phase;
+  size_t tokens = 0;
+  size_t nodes = 0;
+  size_t out_bytes = 0;
+  size_t arena_bytes = 0;
+  size_t allocations = 0;
+  size_t allocated_bytes = 0;
+  double seconds = 1e300;
+};
+
+static long peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Runs `f` `iterations` times, keeping the best time and the allocations of
+// the last run.
+template <typename F>
+static void measure(Result &r, int iterations, F f) {
+  for (int i = 0; i < iterations; i++) {
+    size_t a = allocations.load(std::memory_order_relaxed), b = allocated_bytes.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    if (d.count() < r.seconds) r.seconds = d.count();
+    r.allocations = allocations.load(std::memory_order_relaxed) - a;
+    r.allocated_bytes = allocated_bytes.load(std::memory_order_relaxed) - b;
+  }
+}
+
+static void report(const string &path, size_t bytes, int iterations, const Result &r) {
+  std::cout << "{\"file\": \"" << path << "\", \"phase\": \"" << r.phase << "\""
+            << ", \"iterations\": " << iterations << ", \"seconds\": " << r.seconds
+            << ", \"bytes\": " << bytes << ", \"bytes_per_sec\": " << bytes / r.seconds
+            << ", \"tokens\": " << r.tokens << ", \"tokens_per_sec\": " << r.tokens / r.seconds
+            << ", \"nodes\": " << r.nodes << ", \"nodes_per_sec\": " << r.nodes / r.seconds
+            << ", \"output_bytes\": " << r.out_bytes << ", \"arena_bytes\": " << r.arena_bytes
+            << ", \"allocations\": " << r.allocations << ", \"allocated_bytes\": " << r.allocated_bytes
+            << ", \"peak_rss_kb\": " << peak_rss_kb() << "}" << std::endl;
+}
+
+static bool bench_file(const string &path, int iterations) {
+  dasl::MappedFile file;
+  if (!file.open(path)) {
+    std::cerr << "Failed to read file " << path << std::endl;
+    return false;
+  }
+  string_view source = file.view();
+
+  auto lex_with = [&](Result &lex, dasl::LexerBackend backend) {
+    measure(lex, iterations, [&] {
+      dasl::Interner interner;
+      dasl::Lexer lexer(interner, backend);
+      lexer.set_input(source);
+      size_t tokens = 0;
+      while (lexer.get_next_token().kind() != dasl::Parser::symbol_kind::S_YYEOF)
+        tokens++;
+      lex.tokens = tokens;
+    });
+    report(path, source.size(), iterations, lex);
+  };
+  Result lex{ "lex" }, lex_simd{ "lex_simd" };
+  lex_with(lex, dasl::LexerBackend::FLEX);
+  lex_with(lex_simd, dasl::LexerBackend::SIMD);
+
+  Result parse{ "parse" };
+  parse.tokens = lex.tokens;
+  unique_ptr<Env> env;
+  bool ok = true;
+  measure(parse, iterations, [&] {
+    env.reset();
+    env = make_unique<Env>();
+    ok = dasl::parse_source(source, *env, &path);
+  });
+  if (!ok) {
+    for (auto it = env->errors.begin(); it != env->errors.end(); it++)
+      dasl::print_diagnostic(std::cerr, *it, env->lines);
+    return false;
+  }
+  parse.nodes = dasl::pt::FlatTree(*env->pt).size();
+  parse.arena_bytes = env->arena.bytes_used();
+  report(path, source.size(), iterations, parse);
+
+  Result parse_simd{ "parse_simd" };
+  parse_simd.tokens = lex.tokens;
+  parse_simd.nodes = parse.nodes;
+  measure(parse_simd, iterations, [&] {
+    Env env;
+    dasl::parse_source(source, env, &path, dasl::LexerBackend::SIMD);
+    parse_simd.arena_bytes = env.arena.bytes_used();
+  });
+  report(path, source.size(), iterations, parse_simd);
+
+  Result parse_parallel{ "parse_parallel" };
+  parse_parallel.tokens = lex.tokens;
+  parse_parallel.nodes = parse.nodes;
+  dasl::WorkPool pool;
+  measure(parse_parallel, iterations, [&] {
+    Env env;
+    dasl::parse_source_parallel(source, env, pool, &path, dasl::LexerBackend::SIMD);
+    parse_parallel.arena_bytes = env.arena.bytes_used();
+  });
+  report(path, source.size(), iterations, parse_parallel);
+
+  // Counts the PT nodes, which the flat tree's count above does not match
+  // exactly: it also has nodes for ids, symbols and fields.
+  Result walk{ "walk" };
+  measure(walk, iterations, [&] {
+    size_t nodes = 0;
+    dasl::pt::walk_iterative(env->pt, [&nodes](dasl::pt::PT &) { return ++nodes; });
+    walk.nodes = nodes;
+  });
+  report(path, source.size(), iterations, walk);
+
+  // Resolving again overwrites the annotations with the same bindings.
+  auto resolve_with = [&](Result &resolve, dasl::WorkPool *pool) {
+    resolve.nodes = walk.nodes;
+    measure(resolve, iterations, [&] {
+      dasl::pt::Resolution resolution;
+      if (pool) dasl::pt::resolve(*env, resolution, *pool);
+      else dasl::pt::resolve(*env, resolution);
+    });
+    report(path, source.size(), iterations, resolve);
+  };
+  Result resolve{ "resolve" }, resolve_parallel{ "resolve_parallel" };
+  resolve_with(resolve, nullptr);
+  resolve_with(resolve_parallel, &pool);
+
+  dasl::pt::Resolution resolution;
+  dasl::pt::resolve(*env, resolution);
+  Result layout{ "layout" };
+  layout.nodes = walk.nodes;
+  measure(layout, iterations, [&] {
+    dasl::pt::Layouts layouts;
+    dasl::pt::lay_out_records(*env, resolution, layouts);
+  });
+  report(path, source.size(), iterations, layout);
+
+  Result print{ "print" };
+  print.nodes = parse.nodes;
+  measure(print, iterations, [&] { print.out_bytes = env->pt->to_string(*env).size(); });
+  report(path, source.size(), iterations, print);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int iterations = 5;
+  vector<string> files;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (arg == "-h" || arg == "-n") {
+      std::cout << "usage: bench [-n iterations] files..." << std::endl;
+      return arg == "-h" ? 0 : 1;
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (iterations < 1) iterations = 1;
+
+  bool ok = true;
+  for (auto it = files.begin(); it != files.end(); it++)
+    ok = bench_file(*it, iterations) && ok;
+  return ok ? 0 : 1;
+}
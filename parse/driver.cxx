@@ -0,0 +1,145 @@
+#include "driver.hxx"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "lexer.hxx"
+#include <parser.hxx>
+#include "hash_cons.hxx"
+#include "work_pool.hxx"
+
+namespace dasl {
+
+static bool parse(Lexer &lexer, pt::Env &env, const string *filename) {
+  lexer.lines.filename = filename;
+
+  stats::Timer timer(stats::PARSE);
+  Parser parser(lexer, env);
+  int res = parser.parse();
+
+  env.errors.insert(env.errors.begin(), lexer.errors.begin(), lexer.errors.end());
+  env.lines = std::move(lexer.lines);
+  return res == 0;
+}
+
+bool parse_source(string_view source, pt::Env &env, const string *filename, LexerBackend backend) {
+  Lexer lexer(env.interner, backend);
+  lexer.set_input(source);
+  return parse(lexer, env, filename);
+}
+
+// Chunks are at least this large, and there are a few per thread so that a
+// slow one does not hold up the rest.
+static constexpr size_t MIN_CHUNK = 256 * 1024;
+static constexpr size_t CHUNKS_PER_THREAD = 4;
+// A chunk that fails to parse is joined with at most this many of the ones
+// after it before giving up on chunking.
+static constexpr size_t MAX_JOINED = 4;
+
+// Whether a line starting at `at` starts with a statement keyword.
+static bool starts_statement(string_view source, size_t at) {
+  static const string_view keywords[] = { "val", "def", "type", "module" };
+  for (string_view k : keywords) {
+    size_t end = at + k.size();
+    if (source.compare(at, k.size(), k) == 0 && end < source.size() && (source[end] == ' ' || source[end] == '\t'))
+      return true;
+  }
+  return false;
+}
+
+// Offsets at which to cut `source` into about `count` chunks of the same
+// size, including 0 and the size of the source.
+static vector<size_t> cut_points(string_view source, size_t count) {
+  vector<size_t> cuts{ 0 };
+  for (size_t i = 1; i < count; i++) {
+    size_t at = std::max(source.size() / count * i, cuts.back() + 1);
+    size_t newline = source.find('\n', at - 1);
+    while (newline != string_view::npos && !starts_statement(source, newline + 1))
+      newline = source.find('\n', newline + 1);
+    if (newline == string_view::npos) break;
+    cuts.push_back(newline + 1);
+  }
+  cuts.push_back(source.size());
+  return cuts;
+}
+
+// Parses bytes [begin, end) of `source` into a fresh Env, which is returned
+// if the chunk parsed without any diagnostics.
+static unique_ptr<pt::Env> parse_chunk(string_view source, size_t begin, size_t end, Interner &interner,
+                                       const string *filename, LexerBackend backend) {
+  auto env = std::make_unique<pt::Env>(interner);
+  Lexer lexer(interner, backend);
+  lexer.set_input(source.substr(begin, end - begin), uint32_t(begin));
+  if (!parse(lexer, *env, filename) || !env->errors.empty()) return nullptr;
+  return env;
+}
+
+bool parse_source_parallel(string_view source, pt::Env &env, WorkPool &pool, const string *filename,
+                           LexerBackend backend) {
+  size_t count = std::min(pool.size() * CHUNKS_PER_THREAD, source.size() / MIN_CHUNK);
+  vector<size_t> cuts = cut_points(source, count);
+  if (env.on_statement || cuts.size() <= 2) return parse_source(source, env, filename, backend);
+
+  size_t chunks = cuts.size() - 1;
+  vector<unique_ptr<pt::Env>> parts(chunks);
+  std::mutex lock;
+  std::condition_variable done;
+  size_t left = chunks;
+  for (size_t i = 0; i < chunks; i++) {
+    pool.submit([&, i] {
+      parts[i] = parse_chunk(source, cuts[i], cuts[i + 1], env.interner, filename, backend);
+      std::lock_guard<std::mutex> guard(lock);
+      if (--left == 0) done.notify_one();
+    });
+  }
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [&left] { return left == 0; });
+  }
+
+  // Join every failed chunk with the ones after it until they parse.
+  vector<unique_ptr<pt::Env>> programs;
+  for (size_t i = 0; i < chunks;) {
+    size_t last = i + 1;
+    unique_ptr<pt::Env> part = std::move(parts[i]);
+    while (!part && last < chunks && last - i <= MAX_JOINED) {
+      last++;
+      part = parse_chunk(source, cuts[i], cuts[last], env.interner, filename, backend);
+    }
+    if (!part) {
+      programs.clear();
+      return parse_source(source, env, filename, backend);
+    }
+    programs.push_back(std::move(part));
+    i = last;
+  }
+
+  vector<pt::St *> statements;
+  env.lines = std::move(programs[0]->lines);
+  for (auto it = programs.begin(); it != programs.end(); it++) {
+    pt::Env &part = **it;
+    statements.insert(statements.end(), part.pt->statements.begin(), part.pt->statements.end());
+    if (it != programs.begin()) env.lines.append(part.lines);
+    env.arena.adopt(part.arena);
+  }
+  env.pt = env.make<pt::Program>(statements);
+  // Chunks are parsed without a table, each on its own thread.
+  if (env.shared_types) pt::share_types(*env.pt, *env.shared_types);
+  return true;
+}
+
+bool parse_fd(int fd, pt::Env &env, const string *filename) {
+  Lexer lexer(env.interner);
+  lexer.set_input_fd(fd);
+  return parse(lexer, env, filename);
+}
+
+void print_diagnostic(std::ostream &out, const pt::Diagnostic &d, const LineTable &lines) {
+  LineTable::Position at = lines.position(d.span.begin);
+  if (lines.filename) out << *lines.filename << ":";
+  out << at.line << ":" << at.column << ": " << d.message << std::endl;
+}
+
+} // namespace dasl
@@ -0,0 +1,55 @@
+#ifndef DRIVER_HXX
+#define DRIVER_HXX
+
+#include <string>
+using std::string;
+#include <string_view>
+using std::string_view;
+#include <iostream>
+
+#include "mapped_file.hxx"
+#include "parse_tree.hxx"
+
+// Helpers shared by the command line drivers. None of these exit the
+// process; failures are reported through return values and Env::errors.
+namespace dasl {
+
+// Which scanner a Lexer runs, see lexer.hxx.
+enum class LexerBackend { FLEX, SIMD };
+
+// Parses `source` into `env` without copying it first. `filename`, if given, is kept in
+// env.lines for diagnostics and must outlive the tree. Lexer and parser
+// diagnostics are appended to env.errors; returns true if the program parsed.
+bool parse_source(string_view source, pt::Env &env, const string *filename = nullptr,
+                  LexerBackend backend = LexerBackend::FLEX);
+
+class WorkPool;
+
+// Like parse_source, but parses large sources on all threads of `pool`.
+// The source is cut into chunks at lines that start with `val`, `def`,
+// `type` or `module`, and each chunk is lexed and parsed as a program of its
+// own, with spans and lines counted from the start of `source`. A cut can
+// land inside a module or a string, since that would take a full lex to
+// rule out; the chunks on either side of it then fail to parse and are
+// joined and parsed again. Statements of the chunks are moved into one
+// Program in env, and their arenas into env.arena.
+//
+// If a program does not parse at all, it is parsed again from the start on
+// the calling thread, so the diagnostics are those of parse_source. Envs in
+// streaming mode are always parsed that way. Must not be called from a task
+// running on `pool`.
+bool parse_source_parallel(string_view source, pt::Env &env, WorkPool &pool, const string *filename = nullptr,
+                           LexerBackend backend = LexerBackend::FLEX);
+
+// Like parse_source, but reads from `fd` as the parser needs more input, so
+// it works on pipes and terminals. Combined with Env::stream_statements the
+// tree of input of any length takes constant memory; the line table still
+// grows by one entry per line.
+bool parse_fd(int fd, pt::Env &env, const string *filename = nullptr);
+
+// Prints `d` as file:line:column, looking its span up in `lines`.
+void print_diagnostic(std::ostream &out, const pt::Diagnostic &d, const LineTable &lines);
+
+} // namespace dasl
+
+#endif // DRIVER_HXX
@@ -0,0 +1,307 @@
+#include "flat_tree.hxx"
+
+#include <cstring>
+
+#include "parse_tree.hxx"
+#include "printer.hxx"
+
+namespace dasl::pt {
+
+// Mirrors the print() overrides of the PT classes node kind by node kind, so
+// a tree prints the same whether or not it went through a FlatTree.
+class FlatPrinter {
+  const FlatView &t;
+  Printer &p;
+
+  NodeId child(NodeId n, uint32_t i) const { return t.child(n, i); }
+  uint32_t count(NodeId n) const { return t.child_count[n]; }
+  string_view str(NodeId n) const { return t.str(t.data[n]); }
+
+ public:
+  FlatPrinter(const FlatView &t, Printer &p) : t(t), p(p) {}
+
+  void symbol(NodeId n) {
+    for (uint32_t i = 0; i < count(n); i++)
+      p << str(child(n, i)) << '.';
+    p << str(n);
+  }
+
+  void type(NodeId n) {
+    switch (t.kinds[n]) {
+      case NodeKind::LIST_TYPE: p << "list"; break;
+      case NodeKind::MAP_TYPE: p << "map"; break;
+      case NodeKind::ANY_TYPE: p << "any"; break;
+      case NodeKind::RECORD_TYPE: symbol(child(n, 0)); break;
+      case NodeKind::PRIM_TYPE: {
+        static const char *names[] = { "string", "int", "float", "bool", "atom", "()" };
+        p << names[t.ops[n]];
+        break;
+      }
+      default: break;
+    }
+  }
+
+  void value(NodeId n) {
+    switch (t.ops[n]) {
+      case STRING: p << '"' << str(n) << '"'; break;
+      case UNIT: p << "()"; break;
+      case INT: p << t.literals[t.data[n]]; break;
+      case FLOAT: {
+        double f;
+        std::memcpy(&f, &t.literals[t.data[n]], sizeof f);
+        p << f;
+        break;
+      }
+      case BOOL: p << (t.data[n] ? '1' : '0'); break;
+      case ATOM: p << ':' << str(n); break;
+    }
+  }
+
+  void pat_type(NodeId n) {
+    NodeId ty = child(n, 0);
+    if (ty != NO_NODE) {
+      p << ": ";
+      type(ty);
+    }
+  }
+
+  void pat(NodeId n) {
+    switch (t.kinds[n]) {
+      case NodeKind::LIST_PAT: {
+        uint32_t end = count(n) - (t.ops[n] & HAS_TAIL);
+        p << '[';
+        for (uint32_t i = 1; i < end; i++) {
+          if (i > 1) p << ", ";
+          pat(child(n, i));
+        }
+        if (t.ops[n] & HAS_TAIL) {
+          p << " :: ";
+          pat(child(n, end));
+        }
+        p << ']';
+        break;
+      }
+      case NodeKind::MAP_PAT:
+        p << '{';
+        for (uint32_t i = 1; i < count(n); i += 2) {
+          p << (i == 1 ? " " : ", ");
+          pat(child(n, i));
+          p << " => ";
+          pat(child(n, i + 1));
+        }
+        p << " }";
+        break;
+      case NodeKind::RECORD_PAT:
+        symbol(child(n, 1));
+        p << " {";
+        for (uint32_t i = 2; i < count(n); i++) {
+          NodeId f = child(n, i);
+          p << (i == 2 ? " " : ", ") << str(f) << ": ";
+          pat(child(f, 0));
+        }
+        p << " }";
+        break;
+      case NodeKind::SYMBOL_PAT: symbol(child(n, 1)); break;
+      case NodeKind::VALUE_PAT: value(n); break;
+      default: break;
+    }
+    pat_type(n);
+  }
+
+  void body(NodeId seq) {
+    p.scope_start();
+    for (uint32_t i = 0; i < count(seq); i++) {
+      p.indent();
+      st(child(seq, i));
+      p << '\n';
+    }
+    p.scope_end();
+  }
+
+  void expr(NodeId n) {
+    switch (t.kinds[n]) {
+      case NodeKind::IF_ELSE_EXPR:
+        p.indent();
+        p << "if ";
+        expr(child(n, 1));
+        p << " then\n";
+        body(child(n, 2));
+        if (count(n) > 3) {
+          p.indent();
+          p << "else\n";
+          body(child(n, 3));
+        }
+        p.indent();
+        p << "end\n";
+        break;
+      case NodeKind::CASE_EXPR:
+        p.indent();
+        p << "case ";
+        expr(child(n, 1));
+        p << " of\n";
+        p.scope_start();
+        for (uint32_t i = 2; i < count(n); i++) {
+          NodeId c = child(n, i);
+          p.indent();
+          p << "| ";
+          pat(child(c, 0));
+          p << " => ";
+          expr(child(c, 1));
+          p << '\n';
+        }
+        p.scope_end();
+        break;
+      case NodeKind::RECORD_EXPR:
+        symbol(child(n, 1));
+        p << " { ";
+        for (uint32_t i = 2; i < count(n); i++) {
+          NodeId f = child(n, i);
+          if (i > 2) p << ", ";
+          p << str(f) << ": ";
+          expr(child(f, 0));
+        }
+        p << " }";
+        break;
+      case NodeKind::LIST_EXPR: {
+        uint32_t end = count(n) - (t.ops[n] & HAS_TAIL);
+        p << '[';
+        for (uint32_t i = 1; i < end; i++) {
+          if (i > 1) p << ", ";
+          expr(child(n, i));
+        }
+        if (t.ops[n] & HAS_TAIL) {
+          p << " :: ";
+          expr(child(n, end));
+        }
+        p << ']';
+        break;
+      }
+      case NodeKind::MAP_EXPR:
+        p << "{ ";
+        for (uint32_t i = 1; i < count(n); i += 2) {
+          if (i > 1) p << ", ";
+          expr(child(n, i));
+          p << " => ";
+          expr(child(n, i + 1));
+        }
+        p << " }";
+        break;
+      case NodeKind::VALUE_EXPR: value(n); break;
+      case NodeKind::SYMBOL_EXPR: symbol(child(n, 1)); break;
+      case NodeKind::CALL_EXPR:
+        symbol(child(n, 1));
+        p << '(';
+        for (uint32_t i = 2; i < count(n); i++) {
+          if (i > 2) p << ", ";
+          expr(child(n, i));
+        }
+        p << ')';
+        break;
+      case NodeKind::BIN_OP_EXPR: {
+        static const char *ops[] = { "+", "-", "*", "/", "%", "&&", "||", "^^", "band", "bor", "bxor",
+                                     "==", "!=", "<<", ">>", "[]", ">", ">=", "<", "<=" };
+        if (t.ops[n] == BinOpExpr::INDEX) {
+          expr(child(n, 1));
+          p << '[';
+          expr(child(n, 2));
+          p << ']';
+          break;
+        }
+        p << '(';
+        expr(child(n, 1));
+        p << ' ' << ops[t.ops[n]] << ' ';
+        expr(child(n, 2));
+        p << ')';
+        break;
+      }
+      case NodeKind::UN_OP_EXPR:
+        p << "!~-"[t.ops[n]];
+        expr(child(n, 1));
+        break;
+      case NodeKind::COMPOUND_EXPR:
+        for (uint32_t i = 1; i < count(n); i++) {
+          if (i > 1) p << "; ";
+          expr(child(n, i));
+        }
+        break;
+      default: break;
+    }
+  }
+
+  void st(NodeId n) {
+    switch (t.kinds[n]) {
+      case NodeKind::DEF_ST: {
+        NodeId args = child(n, 1), seq = child(n, 2);
+        p.indent();
+        p << "def " << str(n) << '(';
+        for (uint32_t i = 0; i < count(args); i++) {
+          if (i) p << ", ";
+          pat(child(args, i));
+        }
+        p << ')';
+        if (child(n, 0) != NO_NODE) {
+          p << " => ";
+          type(child(n, 0));
+        }
+        p << ":\n";
+
+        p.scope_start();
+        for (uint32_t i = 0; i < count(seq); i++) {
+          if (i) p << ";\n";
+          p.indent();
+          st(child(seq, i));
+        }
+        p << '\n';
+        p.scope_end();
+
+        p.indent();
+        p << "end\n";
+        break;
+      }
+      case NodeKind::RECORD_ST:
+        p << "type " << str(n) << " = ";
+        if (count(n) == 0) {
+          p << "{}";
+          break;
+        }
+        p << "{ ";
+        for (uint32_t i = 0; i < count(n); i++) {
+          NodeId f = child(n, i);
+          if (i) p << ", ";
+          p << str(f) << ": ";
+          type(child(f, 0));
+        }
+        p << " }";
+        break;
+      case NodeKind::VAL_ST:
+        p << "val " << str(n) << " = ";
+        expr(child(n, 0));
+        break;
+      case NodeKind::MODULE_ST:
+        p.indent();
+        p << "module " << str(n) << '\n';
+        p.scope_start();
+        for (uint32_t i = 0; i < count(n); i++) {
+          p.indent();
+          st(child(n, i));
+          p << '\n';
+        }
+        p.scope_end();
+        p.indent();
+        p << "end\n";
+        break;
+      case NodeKind::EXPR_ST: expr(child(n, 0)); break;
+      default: break;
+    }
+  }
+};
+
+void print(const FlatView &tree, Printer &p) {
+  FlatPrinter printer(tree, p);
+  for (uint32_t i = 0; i < tree.statement_count; i++) {
+    printer.st(tree.statements[i]);
+    p << '\n';
+  }
+}
+
+} // namespace dasl::pt
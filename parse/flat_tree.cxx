@@ -0,0 +1,320 @@
+#include "flat_tree.hxx"
+
+#include <cstring>
+
+#include "parse_tree.hxx"
+
+namespace dasl::pt {
+
+FlatTree::FlatTree(const Program &program) {
+  for (auto it = program.statements.cbegin(); it != program.statements.cend(); it++)
+    append(**it);
+}
+
+void FlatTree::append(const St &st) {
+  statements.push_back(st.flatten(*this));
+}
+
+NodeId FlatTree::close(size_t mark, NodeKind kind, const Span &span, uint8_t op, uint32_t data) {
+  NodeId id = kinds.size();
+  kinds.push_back(kind);
+  ops.push_back(op);
+  this->data.push_back(data);
+  first_child.push_back(children.size());
+  child_count.push_back(pending.size() - mark);
+  spans.push_back(span);
+
+  children.insert(children.end(), pending.begin() + mark, pending.end());
+  pending.resize(mark);
+  return id;
+}
+
+FlatView FlatTree::view(const Interner &interner) const {
+  FlatView v;
+  v.kinds = kinds.data();
+  v.ops = ops.data();
+  v.data = data.data();
+  v.first_child = first_child.data();
+  v.child_count = child_count.data();
+  v.spans = spans.data();
+  v.nodes = size();
+  v.children = children.data();
+  v.literals = literals.data();
+  v.statements = statements.data();
+  v.statement_count = statements.size();
+  v.interner = &interner;
+  return v;
+}
+
+uint32_t FlatTree::add_literal(uint64_t bits) {
+  literals.push_back(bits);
+  return literals.size() - 1;
+}
+
+static NodeId flatten_type(const Type *type, FlatTree &tree) {
+  return type ? type->flatten(tree) : NO_NODE;
+}
+
+static NodeId flatten_id(const Id &id, FlatTree &tree) {
+  return tree.close(tree.open(), NodeKind::ID, id.span, 0, id.val.i);
+}
+
+static NodeId flatten_symbol(const SymbolRef &symbol, FlatTree &tree) {
+  size_t m = tree.open();
+  for (auto it = symbol.modules.cbegin(); it != symbol.modules.cend(); it++)
+    tree.push(flatten_id(*it, tree));
+  return tree.close(m, NodeKind::SYMBOL, symbol.span, 0, symbol.name.val.i);
+}
+
+static NodeId flatten_value(const Value &value, const Type *type, NodeKind kind, const Span &span,
+                            FlatTree &tree) {
+  uint32_t data = 0;
+  switch (value.kind) {
+    case STRING:
+      data = std::get<STRING>(value.value).val.i;
+      break;
+    case ATOM:
+      data = std::get<ATOM>(value.value).val.i;
+      break;
+    case INT:
+      data = tree.add_literal(std::get<INT>(value.value));
+      break;
+    case FLOAT: {
+      uint64_t bits;
+      double f = std::get<FLOAT>(value.value);
+      std::memcpy(&bits, &f, sizeof bits);
+      data = tree.add_literal(bits);
+      break;
+    }
+    case BOOL:
+      data = std::get<BOOL>(value.value);
+      break;
+    case UNIT:
+      break;
+  }
+
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  return tree.close(m, kind, span, value.kind, data);
+}
+
+static NodeId flatten_seq(const vector<St *> &body, const Span &span, FlatTree &tree) {
+  size_t m = tree.open();
+  for (auto it = body.cbegin(); it != body.cend(); it++)
+    tree.push((*it)->flatten(tree));
+  return tree.close(m, NodeKind::SEQ, span);
+}
+
+// Types
+
+NodeId ListType::flatten(FlatTree &tree) const { return tree.close(tree.open(), NodeKind::LIST_TYPE, span); }
+
+NodeId MapType::flatten(FlatTree &tree) const { return tree.close(tree.open(), NodeKind::MAP_TYPE, span); }
+
+NodeId RecordType::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_symbol(symbol, tree));
+  return tree.close(m, NodeKind::RECORD_TYPE, span);
+}
+
+NodeId AnyType::flatten(FlatTree &tree) const { return tree.close(tree.open(), NodeKind::ANY_TYPE, span); }
+
+NodeId PrimType::flatten(FlatTree &tree) const { return tree.close(tree.open(), NodeKind::PRIM_TYPE, span, kind); }
+
+// Patterns
+
+NodeId ListPat::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  uint8_t op = 0;
+  tree.push(flatten_type(type, tree));
+
+  for (auto it = pats.cbegin(); it != pats.cend(); it++)
+    tree.push((*it)->flatten(tree));
+  if (tail) {
+    tree.push(tail->flatten(tree));
+    op = HAS_TAIL;
+  }
+  return tree.close(m, NodeKind::LIST_PAT, span, op);
+}
+
+NodeId MapPat::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  for (auto it = entries.cbegin(); it != entries.cend(); it++) {
+    tree.push(it->first->flatten(tree));
+    tree.push(it->second->flatten(tree));
+  }
+  return tree.close(m, NodeKind::MAP_PAT, span);
+}
+
+NodeId RecordPat::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(flatten_symbol(record_name, tree));
+  for (auto it = fields.cbegin(); it != fields.cend(); it++) {
+    size_t f = tree.open();
+    tree.push(it->second->flatten(tree));
+    tree.push(tree.close(f, NodeKind::FIELD, it->first.span, 0, it->first.val.i));
+  }
+  return tree.close(m, NodeKind::RECORD_PAT, span);
+}
+
+NodeId SymbolPat::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(flatten_symbol(symbol, tree));
+  return tree.close(m, NodeKind::SYMBOL_PAT, span);
+}
+
+NodeId ValuePat::flatten(FlatTree &tree) const {
+  return flatten_value(value, type, NodeKind::VALUE_PAT, span, tree);
+}
+
+// Expressions
+
+NodeId IfElseExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(cond->flatten(tree));
+  tree.push(flatten_seq(body, span, tree));
+  if (else_body) tree.push(flatten_seq(*else_body, span, tree));
+  return tree.close(m, NodeKind::IF_ELSE_EXPR, span);
+}
+
+NodeId CaseExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(value->flatten(tree));
+  for (auto it = cases.cbegin(); it != cases.cend(); it++) {
+    size_t c = tree.open();
+    tree.push(it->first->flatten(tree));
+    tree.push(it->second->flatten(tree));
+    tree.push(tree.close(c, NodeKind::CASE, it->first->span));
+  }
+  return tree.close(m, NodeKind::CASE_EXPR, span);
+}
+
+NodeId RecordExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(flatten_symbol(name, tree));
+  for (auto it = fields.cbegin(); it != fields.cend(); it++) {
+    size_t f = tree.open();
+    tree.push(it->second->flatten(tree));
+    tree.push(tree.close(f, NodeKind::FIELD, it->first.span, 0, it->first.val.i));
+  }
+  return tree.close(m, NodeKind::RECORD_EXPR, span);
+}
+
+NodeId ListExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  uint8_t op = 0;
+  tree.push(flatten_type(type, tree));
+
+  for (auto it = values.cbegin(); it != values.cend(); it++)
+    tree.push((*it)->flatten(tree));
+  if (tail) {
+    tree.push(tail->flatten(tree));
+    op = HAS_TAIL;
+  }
+  return tree.close(m, NodeKind::LIST_EXPR, span, op);
+}
+
+NodeId MapExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  for (auto it = items.cbegin(); it != items.cend(); it++) {
+    tree.push(it->first->flatten(tree));
+    tree.push(it->second->flatten(tree));
+  }
+  return tree.close(m, NodeKind::MAP_EXPR, span);
+}
+
+NodeId ValueExpr::flatten(FlatTree &tree) const {
+  return flatten_value(value, type, NodeKind::VALUE_EXPR, span, tree);
+}
+
+NodeId SymbolExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(flatten_symbol(symbol, tree));
+  return tree.close(m, NodeKind::SYMBOL_EXPR, span);
+}
+
+NodeId CallExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(flatten_symbol(name, tree));
+  for (auto it = args.cbegin(); it != args.cend(); it++)
+    tree.push((*it)->flatten(tree));
+  return tree.close(m, NodeKind::CALL_EXPR, span);
+}
+
+NodeId BinOpExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(lhs->flatten(tree));
+  tree.push(rhs->flatten(tree));
+  return tree.close(m, NodeKind::BIN_OP_EXPR, span, op);
+}
+
+NodeId UnOpExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  tree.push(value->flatten(tree));
+  return tree.close(m, NodeKind::UN_OP_EXPR, span, op);
+}
+
+NodeId CompoundExpr::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+  for (auto it = exprs.cbegin(); it != exprs.cend(); it++)
+    tree.push((*it)->flatten(tree));
+  return tree.close(m, NodeKind::COMPOUND_EXPR, span);
+}
+
+// Statements
+
+NodeId DefSt::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(flatten_type(type, tree));
+
+  size_t a = tree.open();
+  for (auto it = args.cbegin(); it != args.cend(); it++)
+    tree.push((*it)->flatten(tree));
+  tree.push(tree.close(a, NodeKind::SEQ, span));
+
+  tree.push(flatten_seq(body, span, tree));
+  return tree.close(m, NodeKind::DEF_ST, span, 0, name.val.i);
+}
+
+NodeId RecordSt::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  for (auto it = fields.cbegin(); it != fields.cend(); it++) {
+    size_t f = tree.open();
+    tree.push(it->second->flatten(tree));
+    tree.push(tree.close(f, NodeKind::FIELD, it->first.span, 0, it->first.val.i));
+  }
+  return tree.close(m, NodeKind::RECORD_ST, span, 0, name.val.i);
+}
+
+NodeId ValSt::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(expr->flatten(tree));
+  return tree.close(m, NodeKind::VAL_ST, span, 0, name.val.i);
+}
+
+NodeId ModuleSt::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  for (auto it = statements.cbegin(); it != statements.cend(); it++)
+    tree.push((*it)->flatten(tree));
+  return tree.close(m, NodeKind::MODULE_ST, span, 0, name.val.i);
+}
+
+NodeId ExprSt::flatten(FlatTree &tree) const {
+  size_t m = tree.open();
+  tree.push(expr->flatten(tree));
+  return tree.close(m, NodeKind::EXPR_ST, span);
+}
+
+} // namespace dasl::pt
@@ -0,0 +1,157 @@
+#ifndef FLAT_TREE_HXX
+#define FLAT_TREE_HXX
+
+#include <cstdint>
+
+#include <string_view>
+using std::string_view;
+#include <vector>
+using std::vector;
+
+#include "interner.hxx"
+
+#include "source_map.hxx"
+using dasl::Span;
+
+namespace dasl::pt {
+
+class Program;
+class St;
+class Printer;
+
+// Compact, index-based alternative to the PT graph. Every node is a row in a
+// set of parallel arrays and is addressed by a 32-bit NodeId. Children of a
+// node are a contiguous range of `children`. Nodes are appended in post-order,
+// so a linear scan over the arrays visits children before their parents.
+typedef uint32_t NodeId;
+constexpr NodeId NO_NODE = ~0U;
+
+// Child layout per kind. Every Pat and Expr has its type annotation (or
+// NO_NODE) as child 0. `op` and `data` are described where they are used.
+enum class NodeKind : uint8_t {
+  // Types. PRIM_TYPE: op = PrimType::PrimKind. RECORD_TYPE: [symbol].
+  LIST_TYPE, MAP_TYPE, RECORD_TYPE, ANY_TYPE, PRIM_TYPE,
+
+  // Patterns.
+  LIST_PAT,    // [type, elements..., tail?], op = HAS_TAIL when a tail is present
+  MAP_PAT,     // [type, key, value, key, value...]
+  RECORD_PAT,  // [type, symbol, FIELD...]
+  SYMBOL_PAT,  // [type, symbol]
+  VALUE_PAT,   // [type], op = ValueKind, data = see VALUE_EXPR
+
+  // Expressions.
+  IF_ELSE_EXPR,   // [type, cond, SEQ, SEQ?]
+  CASE_EXPR,      // [type, value, CASE...]
+  RECORD_EXPR,    // [type, symbol, FIELD...]
+  LIST_EXPR,      // [type, elements..., tail?], op = HAS_TAIL when a tail is present
+  MAP_EXPR,       // [type, key, value, key, value...]
+  VALUE_EXPR,     // [type], op = ValueKind; data = istring for strings and atoms,
+                  // an index into `literals` for ints and floats, 0/1 for bools
+  SYMBOL_EXPR,    // [type, symbol]
+  CALL_EXPR,      // [type, symbol, args...]
+  BIN_OP_EXPR,    // [type, lhs, rhs], op = BinOpExpr::BinOp
+  UN_OP_EXPR,     // [type, value], op = UnOpExpr::UnOp
+  COMPOUND_EXPR,  // [type, exprs...]
+
+  // Statements. data = istring of the name where there is one.
+  DEF_ST,     // [return type, SEQ of args, SEQ of body]
+  RECORD_ST,  // [FIELD...] whose child is the field type
+  VAL_ST,     // [expr]
+  MODULE_ST,  // [statements...]
+  EXPR_ST,    // [expr]
+
+  // Helpers.
+  SYMBOL,  // data = istring of the name, [ID...] for the module path
+  ID,      // data = istring
+  FIELD,   // data = istring of the atom, [value]
+  CASE,    // [pat, expr]
+  SEQ,     // [items...]
+
+  // Only in the PT, never flattened. NONE tags the values, ids and symbols
+  // embedded in other nodes; they are not visited on their own.
+  FOR_ST, PROGRAM, NONE,
+};
+
+constexpr uint8_t HAS_TAIL = 1;
+
+// Read-only view of a flattened tree, over either a FlatTree or a serialized
+// one loaded from disk (see ast_file.hxx). Strings in `data` are istrings of
+// `interner` when there is one, and indices into a string table otherwise.
+struct FlatView {
+  const NodeKind *kinds = nullptr;
+  const uint8_t *ops = nullptr;
+  const uint32_t *data = nullptr;
+  const uint32_t *first_child = nullptr;
+  const uint32_t *child_count = nullptr;
+  const Span *spans = nullptr;
+  NodeId nodes = 0;
+
+  const NodeId *children = nullptr;
+  const uint64_t *literals = nullptr;
+  const NodeId *statements = nullptr;
+  uint32_t statement_count = 0;
+
+  const Interner *interner = nullptr;
+  // String i is bytes [string_offsets[i], string_offsets[i + 1]).
+  const uint32_t *string_offsets = nullptr;
+  const char *string_bytes = nullptr;
+
+  NodeId child(NodeId n, uint32_t i) const { return children[first_child[n] + i]; }
+  const NodeId *children_begin(NodeId n) const { return children + first_child[n]; }
+  const NodeId *children_end(NodeId n) const { return children_begin(n) + child_count[n]; }
+
+  string_view str(uint32_t s) const {
+    if (interner) return interner->get_string(istring{ s });
+    return string_view(string_bytes + string_offsets[s], string_offsets[s + 1] - string_offsets[s]);
+  }
+};
+
+class FlatTree {
+  // Child ids of nodes that are still being built. A node's children are
+  // pushed here while they are flattened and copied to `children` in one
+  // piece when the node itself is added.
+  vector<NodeId> pending;
+
+ public:
+  vector<NodeKind> kinds;
+  vector<uint8_t> ops;
+  vector<uint32_t> data;
+  vector<uint32_t> first_child;
+  vector<uint32_t> child_count;
+  vector<Span> spans;
+
+  vector<NodeId> children;
+  vector<uint64_t> literals;
+
+  // Top level statements, in source order.
+  vector<NodeId> statements;
+
+  FlatTree() = default;
+  explicit FlatTree(const Program &program);
+
+  NodeId size() const { return kinds.size(); }
+
+  NodeId child(NodeId n, uint32_t i) const { return children[first_child[n] + i]; }
+  const NodeId *children_begin(NodeId n) const { return children.data() + first_child[n]; }
+  const NodeId *children_end(NodeId n) const { return children_begin(n) + child_count[n]; }
+
+  // `interner` is the one the flattened tree's strings belong to.
+  FlatView view(const Interner &interner) const;
+
+  // Flattens one top level statement and appends it to `statements`.
+  void append(const St &st);
+
+  // Building blocks used by the flatten() overrides.
+  size_t open() const { return pending.size(); }
+  void push(NodeId child) { pending.push_back(child); }
+  NodeId close(size_t mark, NodeKind kind, const Span &span, uint8_t op = 0, uint32_t data = 0);
+  uint32_t add_literal(uint64_t bits);
+};
+
+// Prints `tree` exactly as Program::print prints the program it was
+// flattened from.
+void print(const FlatView &tree, Printer &p);
+
+} // namespace dasl::pt
+
+#endif // FLAT_TREE_HXX
@@ -0,0 +1,287 @@
+#include "fold.hxx"
+
+#include <cmath>
+#include <cstdint>
+
+#include "visit.hxx"
+
+using std::nullopt;
+
+namespace dasl::pt {
+
+namespace {
+
+// A value of the given kind, built from one of the ValueType alternatives.
+template <ValueKind K, typename T>
+Value make_value(T v) {
+  return Value(ValueType(std::in_place_index<K>, v));
+}
+
+optional<Value> fold_int(BinOpExpr::BinOp op, uint64_t a, uint64_t b) {
+  int64_t x = int64_t(a), y = int64_t(b);
+  switch (op) {
+    case BinOpExpr::ADD: return make_value<INT>(a + b);
+    case BinOpExpr::SUB: return make_value<INT>(a - b);
+    case BinOpExpr::MUL: return make_value<INT>(a * b);
+    case BinOpExpr::DIV:
+      if (y == 0) return nullopt;
+      if (x == INT64_MIN && y == -1) return make_value<INT>(a);
+      return make_value<INT>(uint64_t(x / y));
+    case BinOpExpr::MOD:
+      if (y == 0) return nullopt;
+      if (x == INT64_MIN && y == -1) return make_value<INT>(uint64_t(0));
+      return make_value<INT>(uint64_t(x % y));
+    case BinOpExpr::BAND: return make_value<INT>(a & b);
+    case BinOpExpr::BOR: return make_value<INT>(a | b);
+    case BinOpExpr::BXOR: return make_value<INT>(a ^ b);
+    case BinOpExpr::LSH:
+      if (y < 0 || y > 63) return nullopt;
+      return make_value<INT>(a << y);
+    case BinOpExpr::RSH:
+      if (y < 0 || y > 63) return nullopt;
+      return make_value<INT>(uint64_t(x >> y));
+    case BinOpExpr::EQ: return make_value<BOOL>(x == y);
+    case BinOpExpr::NEQ: return make_value<BOOL>(x != y);
+    case BinOpExpr::GT: return make_value<BOOL>(x > y);
+    case BinOpExpr::GTE: return make_value<BOOL>(x >= y);
+    case BinOpExpr::LT: return make_value<BOOL>(x < y);
+    case BinOpExpr::LTE: return make_value<BOOL>(x <= y);
+    default: return nullopt;
+  }
+}
+
+optional<Value> fold_float(BinOpExpr::BinOp op, double x, double y) {
+  double r;
+  switch (op) {
+    case BinOpExpr::ADD: r = x + y; break;
+    case BinOpExpr::SUB: r = x - y; break;
+    case BinOpExpr::MUL: r = x * y; break;
+    case BinOpExpr::DIV: r = x / y; break;
+    case BinOpExpr::MOD: r = std::fmod(x, y); break;
+    case BinOpExpr::EQ: return make_value<BOOL>(x == y);
+    case BinOpExpr::NEQ: return make_value<BOOL>(x != y);
+    case BinOpExpr::GT: return make_value<BOOL>(x > y);
+    case BinOpExpr::GTE: return make_value<BOOL>(x >= y);
+    case BinOpExpr::LT: return make_value<BOOL>(x < y);
+    case BinOpExpr::LTE: return make_value<BOOL>(x <= y);
+    default: return nullopt;
+  }
+  if (!std::isfinite(r)) return nullopt;
+  return make_value<FLOAT>(r);
+}
+
+optional<Value> fold_bool(BinOpExpr::BinOp op, bool x, bool y) {
+  switch (op) {
+    case BinOpExpr::LAND:
+    case BinOpExpr::BAND: return make_value<BOOL>(x && y);
+    case BinOpExpr::LOR:
+    case BinOpExpr::BOR: return make_value<BOOL>(x || y);
+    case BinOpExpr::LXOR:
+    case BinOpExpr::BXOR:
+    case BinOpExpr::NEQ: return make_value<BOOL>(x != y);
+    case BinOpExpr::EQ: return make_value<BOOL>(x == y);
+    default: return nullopt;
+  }
+}
+
+// Strings are interned as written, escapes included, so two spellings of
+// the same string only compare correctly if neither has any.
+optional<Value> fold_string(BinOpExpr::BinOp op, istring a, istring b, Interner &interner) {
+  string_view x = interner.get_string(a), y = interner.get_string(b);
+  if (op == BinOpExpr::ADD) {
+    string joined;
+    joined.reserve(x.size() + y.size());
+    joined.append(x).append(y);
+    return make_value<STRING>(StringValue(interner.get(joined)));
+  }
+  if (x.find('\\') != string_view::npos || y.find('\\') != string_view::npos) return nullopt;
+  switch (op) {
+    case BinOpExpr::EQ: return make_value<BOOL>(x == y);
+    case BinOpExpr::NEQ: return make_value<BOOL>(x != y);
+    case BinOpExpr::GT: return make_value<BOOL>(x > y);
+    case BinOpExpr::GTE: return make_value<BOOL>(x >= y);
+    case BinOpExpr::LT: return make_value<BOOL>(x < y);
+    case BinOpExpr::LTE: return make_value<BOOL>(x <= y);
+    default: return nullopt;
+  }
+}
+
+optional<Value> fold_binary(BinOpExpr::BinOp op, const Value &a, const Value &b, Interner &interner) {
+  if (a.kind != b.kind) return nullopt;
+  bool eq = op == BinOpExpr::EQ, neq = op == BinOpExpr::NEQ;
+  switch (a.kind) {
+    case INT: return fold_int(op, std::get<INT>(a.value), std::get<INT>(b.value));
+    case FLOAT: return fold_float(op, std::get<FLOAT>(a.value), std::get<FLOAT>(b.value));
+    case BOOL: return fold_bool(op, std::get<BOOL>(a.value), std::get<BOOL>(b.value));
+    case STRING:
+      return fold_string(op, std::get<STRING>(a.value).val, std::get<STRING>(b.value).val, interner);
+    case ATOM:
+      if (!eq && !neq) return nullopt;
+      return make_value<BOOL>((std::get<ATOM>(a.value).val.i == std::get<ATOM>(b.value).val.i) == eq);
+    case UNIT:
+      if (!eq && !neq) return nullopt;
+      return make_value<BOOL>(eq);
+  }
+  return nullopt;
+}
+
+optional<Value> fold_unary(UnOpExpr::UnOp op, const Value &a) {
+  switch (op) {
+    case UnOpExpr::NOT:
+      if (a.kind == BOOL) return make_value<BOOL>(!std::get<BOOL>(a.value));
+      return nullopt;
+    case UnOpExpr::INV:
+      if (a.kind == INT) return make_value<INT>(~uint64_t(std::get<INT>(a.value)));
+      return nullopt;
+    case UnOpExpr::NEG:
+      if (a.kind == INT) return make_value<INT>(0 - uint64_t(std::get<INT>(a.value)));
+      if (a.kind == FLOAT) return make_value<FLOAT>(-std::get<FLOAT>(a.value));
+      return nullopt;
+  }
+  return nullopt;
+}
+
+const Value *literal(const Expr *e) {
+  const ValueExpr *v = node_cast<ValueExpr>(e);
+  return v ? &v->value : nullptr;
+}
+
+// Calls `f` on every slot of `node` that holds an expression.
+template <typename F>
+void for_each_expr_slot(PT &node, F &&f) {
+  switch (node.tag) {
+    case NodeKind::IF_ELSE_EXPR:
+      f(static_cast<IfElseExpr &>(node).cond);
+      break;
+    case NodeKind::CASE_EXPR: {
+      auto &n = static_cast<CaseExpr &>(node);
+      f(n.value);
+      for (auto it = n.cases.begin(); it != n.cases.end(); it++) f(it->second);
+      break;
+    }
+    case NodeKind::RECORD_EXPR: {
+      auto &n = static_cast<RecordExpr &>(node);
+      for (auto it = n.fields.begin(); it != n.fields.end(); it++) f(it->second);
+      break;
+    }
+    case NodeKind::LIST_EXPR: {
+      auto &n = static_cast<ListExpr &>(node);
+      for (auto it = n.values.begin(); it != n.values.end(); it++) f(*it);
+      if (n.tail) f(n.tail);
+      break;
+    }
+    case NodeKind::MAP_EXPR: {
+      auto &n = static_cast<MapExpr &>(node);
+      for (auto it = n.items.begin(); it != n.items.end(); it++) {
+        f(it->first);
+        f(it->second);
+      }
+      break;
+    }
+    case NodeKind::CALL_EXPR: {
+      auto &n = static_cast<CallExpr &>(node);
+      for (auto it = n.args.begin(); it != n.args.end(); it++) f(*it);
+      break;
+    }
+    case NodeKind::BIN_OP_EXPR: {
+      auto &n = static_cast<BinOpExpr &>(node);
+      f(n.lhs);
+      f(n.rhs);
+      break;
+    }
+    case NodeKind::UN_OP_EXPR:
+      f(static_cast<UnOpExpr &>(node).value);
+      break;
+    case NodeKind::COMPOUND_EXPR: {
+      auto &n = static_cast<CompoundExpr &>(node);
+      for (auto it = n.exprs.begin(); it != n.exprs.end(); it++) f(*it);
+      break;
+    }
+    case NodeKind::VAL_ST:
+      f(static_cast<ValSt &>(node).expr);
+      break;
+    case NodeKind::EXPR_ST:
+      f(static_cast<ExprSt &>(node).expr);
+      break;
+    case NodeKind::FOR_ST:
+      f(static_cast<ForSt &>(node).container);
+      break;
+    default:
+      break;
+  }
+}
+
+struct Folder {
+  Env &env;
+  FoldStats stats;
+
+  Expr *value(const Expr &e, Value v) {
+    ValueExpr *folded = env.make<ValueExpr>(std::move(v));
+    folded->span = e.span;
+    folded->type = e.type;
+    return folded;
+  }
+
+  // Returns what `e` folds to, given that its children have been folded.
+  Expr *fold(Expr *e) {
+    switch (e->tag) {
+      case NodeKind::BIN_OP_EXPR: {
+        auto *n = static_cast<BinOpExpr *>(e);
+        const Value *a = literal(n->lhs), *b = literal(n->rhs);
+        if (!a || !b) return e;
+        optional<Value> v = fold_binary(n->op, *a, *b, env.interner);
+        if (!v) return e;
+        stats.folded++;
+        return value(*e, std::move(*v));
+      }
+      case NodeKind::UN_OP_EXPR: {
+        auto *n = static_cast<UnOpExpr *>(e);
+        const Value *a = literal(n->value);
+        if (!a) return e;
+        optional<Value> v = fold_unary(n->op, *a);
+        if (!v) return e;
+        stats.folded++;
+        return value(*e, std::move(*v));
+      }
+      case NodeKind::IF_ELSE_EXPR:
+        return prune(static_cast<IfElseExpr *>(e));
+      default:
+        return e;
+    }
+  }
+
+  Expr *prune(IfElseExpr *e) {
+    const Value *cond = literal(e->cond);
+    if (!cond || cond->kind != BOOL) return e;
+    if (std::get<BOOL>(cond->value)) {
+      if (!e->else_body) return e;
+      e->else_body.reset();
+    } else {
+      if (!e->else_body) {
+        stats.pruned++;
+        return value(*e, Value(Unit()));
+      }
+      e->body = std::move(*e->else_body);
+      e->else_body.reset();
+      ValueExpr *taken = env.make<ValueExpr>(make_value<BOOL>(true));
+      taken->span = e->cond->span;
+      e->cond = taken;
+    }
+    stats.pruned++;
+    return e;
+  }
+};
+
+} // namespace
+
+FoldStats fold_constants(PT &root, Env &env) {
+  Folder folder{ env };
+  // Children are left before their parent, so by the time a slot is folded
+  // everything below it already is.
+  walk_iterative(&root, [](PT &) { return true; }, [&folder](PT &node) {
+    for_each_expr_slot(node, [&folder](Expr *&slot) { slot = folder.fold(slot); });
+  });
+  return folder.stats;
+}
+
+} // namespace dasl::pt
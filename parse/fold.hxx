@@ -0,0 +1,40 @@
+#ifndef FOLD_HXX
+#define FOLD_HXX
+
+#include "parse_tree.hxx"
+
+namespace dasl::pt {
+
+struct FoldStats {
+  // Operators replaced by the value they compute.
+  size_t folded = 0;
+  // Ifs with a constant condition whose dead branch was dropped.
+  size_t pruned = 0;
+};
+
+// Folds constant expressions everywhere below `root`, in place: a BinOpExpr
+// or UnOpExpr whose operands are values becomes a ValueExpr, bottom up, so
+// whole literal subtrees collapse into one node. New nodes are allocated
+// from `env`. Walks with an explicit stack, so any depth is fine.
+//
+// Only what is certain without types is folded:
+//
+//  - ints are 64-bit two's complement. + - * and negation wrap, / and %
+//    truncate towards zero and min / -1 wraps as well. Shifts by less than
+//    0 or more than 63 bits are left alone, and so is division by zero, so
+//    it still fails at run time. >> is arithmetic. and, or, xor and ~ are
+//    bitwise.
+//  - floats follow IEEE 754 and % is fmod, but results that are not finite
+//    are left alone, since they cannot be written as literals.
+//  - bools take &&, ||, ^^ and their bitwise spellings, and ! (not).
+//  - strings take + (concatenation) and, unless they contain escapes, the
+//    comparisons. Atoms and () take == and !=.
+//
+// Anything else, such as operands of different kinds or indexing, is kept.
+// An if whose condition is a bool value keeps only the branch taken, under
+// the condition `true`; if no branch is taken it becomes ().
+FoldStats fold_constants(PT &root, Env &env);
+
+} // namespace dasl::pt
+
+#endif // FOLD_HXX
@@ -0,0 +1,358 @@
+#include <string>
+using std::string;
+#include <iostream>
+#include <random>
+#include <iterator>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <vector>
+using std::vector;
+
+// Emits a random but syntactically valid .dzl program for benchmarking. The
+// output only depends on the seed and the profile, so a corpus can be
+// regenerated anywhere instead of being checked in.
+
+struct Profile {
+  const char *name;
+  int max_depth;     // nesting of expressions, ifs and modules
+  int record_width;  // fields per record type and record literal
+  int list_length;   // elements per list literal
+  int module_width;  // statements per module
+  int module_share;  // percent of top level statements that are modules
+  int budget;        // rough number of expression nodes per statement
+};
+
+static const Profile profiles[] = {
+  { "mixed", 4, 8, 8, 6, 10, 48 },
+  { "deep", 64, 3, 3, 3, 10, 256 },
+  { "wide", 3, 96, 8, 6, 5, 256 },
+  { "long", 2, 4, 512, 4, 5, 1024 },
+  { "modules", 3, 4, 4, 24, 60, 32 },
+};
+
+// None of these are keywords, so any suffix keeps them lexing as ids.
+static const char *words[] = {
+  "count", "total", "node", "value", "item", "acc", "left", "right", "size", "name",
+  "key", "head", "rest", "index", "buf", "state", "result", "opts", "width", "seen",
+};
+
+static const char *types[] = { "int", "float", "bool", "string", "atom", "any", "list", "map", "()" };
+
+class Generator {
+  std::mt19937_64 rng;
+  const Profile &p;
+  string out;
+  vector<string> records;
+  int budget = 0;
+
+  // Not std::uniform_int_distribution, whose algorithm differs between
+  // standard libraries. The bias of a plain modulus is negligible here.
+  int pick(int n) { return int(rng() % uint64_t(n)); }
+  bool chance(int percent) { return pick(100) < percent; }
+
+  string id() { return string(words[pick(std::size(words))]) + std::to_string(pick(64)); }
+
+  string record_name() {
+    if (records.empty() || chance(20)) {
+      string name = "Rec" + std::to_string(records.size());
+      records.push_back(name);
+      return name;
+    }
+    return records[pick(records.size())];
+  }
+
+  string symbol() {
+    string s;
+    if (chance(15)) s += "Mod" + std::to_string(pick(16)) + ".";
+    return s + id();
+  }
+
+  void type() {
+    if (chance(20)) out += record_name();
+    else out += types[pick(std::size(types))];
+  }
+
+  void literal() {
+    switch (pick(7)) {
+      case 0: out += std::to_string(1 + pick(100000)); break;
+      case 1: out += std::to_string(1 + pick(9)) + "." + std::to_string(pick(1000)) + "e" + std::to_string(pick(8)); break;
+      case 2: out += "\"" + id() + " " + id() + "\""; break;
+      case 3: out += ":" + id(); break;
+      case 4: out += chance(50) ? "true" : "false"; break;
+      case 5: out += "()"; break;
+      default: out += "0x" + std::to_string(1 + pick(9999)); break;
+    }
+  }
+
+  void list(int depth) {
+    out += "[";
+    int n = 1 + pick(p.list_length);
+    for (int i = 0; i < n; i++) {
+      if (i) out += ", ";
+      expr(depth + 1);
+    }
+    if (chance(10)) {
+      out += " :: ";
+      out += id();
+    }
+    out += "]";
+  }
+
+  void record(int depth) {
+    out += record_name() + "{";
+    int n = pick(p.record_width + 1);
+    for (int i = 0; i < n; i++) {
+      if (i) out += ", ";
+      if (chance(50)) out += id() + ": ";
+      else out += ":" + id() + " => ";
+      expr(depth + 1);
+    }
+    out += "}";
+  }
+
+  void primary(int depth) {
+    if (depth >= p.max_depth || --budget <= 0) {
+      if (chance(50)) out += symbol();
+      else literal();
+      return;
+    }
+
+    switch (pick(10)) {
+      case 0: list(depth); break;
+      case 1: record(depth); break;
+      case 2: {
+        out += symbol() + "(";
+        int n = pick(4);
+        for (int i = 0; i < n; i++) {
+          if (i) out += ", ";
+          expr(depth + 1);
+        }
+        out += ")";
+        break;
+      }
+      case 3:
+        out += "(";
+        expr(depth + 1);
+        out += ")";
+        break;
+      case 4:
+        out += id() + "[";
+        expr(depth + 1);
+        out += "]";
+        break;
+      case 5: out += symbol(); break;
+      default: literal(); break;
+    }
+  }
+
+  void operand(int depth) {
+    if (chance(10)) out += "-!~"[pick(3)];
+    primary(depth);
+  }
+
+  void expr(int depth) {
+    static const char *ops[] = { "+", "-", "*", "/", "%", "<<", ">>", "<", "<=", ">", ">=",
+                                 "==", "!=", "and", "or", "xor", "&&", "||", "^^" };
+    operand(depth);
+    int n = depth < p.max_depth && budget > 0 ? pick(4) : 0;
+    for (int i = 0; i < n; i++) {
+      out += " ";
+      out += ops[pick(std::size(ops))];
+      out += " ";
+      operand(depth + 1);
+    }
+  }
+
+  // Ifs and cases only appear where nothing can follow them but the end of
+  // the statement, so they never need parentheses.
+  void rhs(int depth) {
+    if (depth < p.max_depth && chance(15)) {
+      out += "if ";
+      expr(depth + 1);
+      out += " then ";
+      body(depth + 1);
+      if (chance(50)) {
+        out += " else ";
+        body(depth + 1);
+      }
+      out += " end";
+    } else if (depth < p.max_depth && chance(10)) {
+      out += "case ";
+      expr(depth + 1);
+      out += " of ";
+      pattern(depth + 1);
+      out += " => ";
+      expr(depth + 1);
+    } else {
+      expr(depth);
+    }
+  }
+
+  void pattern(int depth) {
+    int kind = depth >= p.max_depth ? 3 + pick(2) : pick(5);
+    switch (kind) {
+      case 0: {
+        out += "[";
+        int n = pick(4);
+        for (int i = 0; i < n; i++) {
+          if (i) out += ", ";
+          pattern(depth + 1);
+        }
+        if (n && chance(50)) out += " :: " + id();
+        out += "]";
+        break;
+      }
+      case 1: {
+        out += record_name() + "{";
+        int n = pick(4);
+        for (int i = 0; i < n; i++) {
+          if (i) out += ", ";
+          out += id() + ": ";
+          pattern(depth + 1);
+        }
+        out += "}";
+        break;
+      }
+      case 2: {
+        out += "{";
+        int n = 1 + pick(3);
+        for (int i = 0; i < n; i++) {
+          if (i) out += ", ";
+          literal();
+          out += " => ";
+          pattern(depth + 1);
+        }
+        out += "}";
+        break;
+      }
+      case 3: out += id(); break;
+      default: literal(); break;
+    }
+  }
+
+  void body(int depth) {
+    int n = 1 + pick(3);
+    for (int i = 0; i < n; i++) {
+      if (i) out += "; ";
+      val(depth);
+    }
+  }
+
+  void val(int depth) {
+    out += "val " + id() + " = ";
+    rhs(depth);
+  }
+
+  void def(int depth) {
+    out += "def " + id() + "(";
+    int n = pick(4);
+    for (int i = 0; i < n; i++) {
+      if (i) out += ", ";
+      pattern(depth + 1);
+      if (chance(50)) {
+        out += ": ";
+        type();
+      }
+    }
+    out += ")";
+    if (chance(50)) {
+      out += " => ";
+      type();
+    }
+    out += " do\n  ";
+    body(depth + 1);
+    out += "\nend";
+  }
+
+  void record_type() {
+    out += "type " + record_name() + " = {";
+    int n = pick(p.record_width + 1);
+    for (int i = 0; i < n; i++) {
+      out += i ? ",\n  " : "\n  ";
+      if (chance(50)) out += id() + ": ";
+      else out += ":" + id() + " => ";
+      type();
+    }
+    out += "\n}";
+  }
+
+  void module(int depth) {
+    out += "module Mod" + std::to_string(pick(16)) + "\n";
+    int n = 1 + pick(p.module_width);
+    for (int i = 0; i < n; i++) {
+      statement(depth + 1, false);
+      out += "\n";
+    }
+    out += "end";
+  }
+
+ public:
+  Generator(uint64_t seed, const Profile &p) : rng(seed), p(p) {}
+
+  void statement(int depth, bool top) {
+    if (top) budget = p.budget;
+    if (depth < p.max_depth && chance(top ? p.module_share : p.module_share / 4)) {
+      module(depth);
+      return;
+    }
+    switch (pick(4)) {
+      case 0: record_type(); break;
+      case 1: def(depth); break;
+      default: val(depth); break;
+    }
+  }
+
+  string &program(size_t statements) {
+    for (size_t i = 0; i < statements; i++) {
+      statement(0, true);
+      out += "\n\n";
+    }
+    return out;
+  }
+};
+
+static void usage() {
+  std::cout << "usage: gen_corpus [-s seed] [-n statements] [-p profile]" << std::endl;
+  std::cout << "profiles:";
+  for (auto &p : profiles)
+    std::cout << " " << p.name;
+  std::cout << std::endl;
+}
+
+int main(int argc, char **argv) {
+  uint64_t seed = 1;
+  size_t statements = 1000;
+  const Profile *profile = &profiles[0];
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-h") {
+      usage();
+      return 0;
+    } else if (i + 1 >= argc) {
+      usage();
+      return 1;
+    } else if (arg == "-s") {
+      seed = strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "-n") {
+      statements = strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "-p") {
+      const char *name = argv[++i];
+      profile = nullptr;
+      for (auto &p : profiles)
+        if (strcmp(p.name, name) == 0) profile = &p;
+      if (!profile) {
+        usage();
+        return 1;
+      }
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  Generator gen(seed, *profile);
+  std::cout << gen.program(statements);
+}
@@ -0,0 +1,376 @@
+#include "hash_cons.hxx"
+
+#include <cstring>
+#include <type_traits>
+
+#include "visit.hxx"
+
+namespace dasl::pt {
+
+namespace {
+
+static constexpr size_t INITIAL_SLOTS = 256;
+
+uint64_t mix(uint64_t h, uint64_t x) {
+  h = (h ^ x) * 0xbf58476d1ce4e5b9ULL;
+  return h ^ (h >> 31);
+}
+
+// What `PT::hash` holds for a node with hash `h`. Slots are found by it, so
+// that contains() can find a node from its `hash` alone.
+uint32_t fold(uint64_t h) {
+  uint32_t folded = uint32_t(h ^ (h >> 32));
+  return folded ? folded : 1;
+}
+
+uint64_t value_bits(const Value &v) {
+  switch (v.kind) {
+    case STRING: return std::get<STRING>(v.value).val.i;
+    case ATOM: return std::get<ATOM>(v.value).val.i;
+    case INT: return std::get<INT>(v.value);
+    case BOOL: return std::get<BOOL>(v.value);
+    case FLOAT: {
+      uint64_t bits;
+      double f = std::get<FLOAT>(v.value);
+      std::memcpy(&bits, &f, sizeof bits);
+      return bits;
+    }
+    case UNIT: return 0;
+  }
+  return 0;
+}
+
+void add_value(vector<uint64_t> &key, const Value &v) {
+  key.push_back(v.kind);
+  key.push_back(value_bits(v));
+}
+
+void add_symbol(vector<uint64_t> &key, const SymbolRef &s) {
+  key.push_back(s.modules.size());
+  for (auto it = s.modules.begin(); it != s.modules.end(); it++) key.push_back(it->val.i);
+  key.push_back(s.name.val.i);
+  // Equal names resolved to different bindings are different symbols.
+  key.push_back(s.target);
+}
+
+template <typename Fields>
+void add_field_names(vector<uint64_t> &key, const Fields &fields) {
+  key.push_back(fields.size());
+  for (auto it = fields.begin(); it != fields.end(); it++) key.push_back(it->first.val.i);
+}
+
+// Appends what `node` holds besides its children to `key`: its kind and the
+// values, names and list shapes that tell it apart from another node with
+// the same children. Returns false if nodes of its kind are never shared.
+bool add_local(vector<uint64_t> &key, const PT &node) {
+  key.push_back(uint64_t(node.tag));
+  switch (node.tag) {
+    case NodeKind::LIST_TYPE:
+    case NodeKind::MAP_TYPE:
+    case NodeKind::ANY_TYPE:
+    case NodeKind::MAP_PAT:
+    case NodeKind::MAP_EXPR:
+      return true;
+    case NodeKind::PRIM_TYPE:
+      key.push_back(static_cast<const PrimType &>(node).kind);
+      return true;
+    case NodeKind::RECORD_TYPE:
+      add_symbol(key, static_cast<const RecordType &>(node).symbol);
+      return true;
+
+    case NodeKind::LIST_PAT: {
+      auto &n = static_cast<const ListPat &>(node);
+      key.push_back(n.pats.size());
+      key.push_back(n.tail != nullptr);
+      return true;
+    }
+    case NodeKind::RECORD_PAT: {
+      auto &n = static_cast<const RecordPat &>(node);
+      add_symbol(key, n.record_name);
+      add_field_names(key, n.fields);
+      return true;
+    }
+    case NodeKind::SYMBOL_PAT:
+      add_symbol(key, static_cast<const SymbolPat &>(node).symbol);
+      return true;
+    case NodeKind::VALUE_PAT:
+      add_value(key, static_cast<const ValuePat &>(node).value);
+      return true;
+
+    case NodeKind::RECORD_EXPR: {
+      auto &n = static_cast<const RecordExpr &>(node);
+      add_symbol(key, n.name);
+      add_field_names(key, n.fields);
+      return true;
+    }
+    case NodeKind::LIST_EXPR: {
+      auto &n = static_cast<const ListExpr &>(node);
+      key.push_back(n.values.size());
+      key.push_back(n.tail != nullptr);
+      return true;
+    }
+    case NodeKind::VALUE_EXPR:
+      add_value(key, static_cast<const ValueExpr &>(node).value);
+      return true;
+    case NodeKind::SYMBOL_EXPR:
+      add_symbol(key, static_cast<const SymbolExpr &>(node).symbol);
+      return true;
+    case NodeKind::CALL_EXPR:
+      add_symbol(key, static_cast<const CallExpr &>(node).name);
+      return true;
+    case NodeKind::BIN_OP_EXPR: {
+      auto &n = static_cast<const BinOpExpr &>(node);
+      key.push_back(n.op);
+      key.push_back(n.slot);
+      return true;
+    }
+    case NodeKind::UN_OP_EXPR:
+      key.push_back(static_cast<const UnOpExpr &>(node).op);
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// The key of a node is its local part, `locals` words long, followed by its
+// children, which are canonical and so compare by pointer. Returns false if
+// the node cannot be shared.
+bool make_key(vector<uint64_t> &key, size_t &locals, const PT &node) {
+  key.clear();
+  if (!add_local(key, node)) return false;
+  locals = key.size();
+  bool canonical = true;
+  for_each_child(node, [&](const PT *child) {
+    canonical = canonical && child->hash;
+    key.push_back(reinterpret_cast<uintptr_t>(child));
+  });
+  return canonical;
+}
+
+// Slots that are const once their node is built are written anyway: the
+// canonical node is equal to the one it replaces.
+template <typename T>
+T &writable(const T &slot) {
+  return const_cast<T &>(slot);
+}
+
+// Calls `f` on every slot of `node` that holds a Type, Pat or Expr, with a
+// reference to the pointer.
+template <typename F>
+void for_each_slot(PT &node, F &&f) {
+  auto each = [&f](auto &slots) {
+    for (auto it = slots.begin(); it != slots.end(); it++) f(writable(*it));
+  };
+  auto pairs = [&f](auto &slots) {
+    for (auto it = slots.begin(); it != slots.end(); it++) {
+      f(writable(it->first));
+      f(writable(it->second));
+    }
+  };
+  auto seconds = [&f](auto &slots) {
+    for (auto it = slots.begin(); it != slots.end(); it++) f(writable(it->second));
+  };
+  auto type = [&f](auto &n) {
+    if (n.type) f(writable(n.type));
+  };
+
+  switch (node.tag) {
+    case NodeKind::LIST_PAT: {
+      auto &n = static_cast<ListPat &>(node);
+      type(n);
+      each(n.pats);
+      if (n.tail) f(writable(n.tail));
+      break;
+    }
+    case NodeKind::MAP_PAT: {
+      auto &n = static_cast<MapPat &>(node);
+      type(n);
+      pairs(n.entries);
+      break;
+    }
+    case NodeKind::RECORD_PAT: {
+      auto &n = static_cast<RecordPat &>(node);
+      type(n);
+      seconds(n.fields);
+      break;
+    }
+    case NodeKind::SYMBOL_PAT:
+    case NodeKind::VALUE_PAT:
+      type(static_cast<Pat &>(node));
+      break;
+
+    case NodeKind::IF_ELSE_EXPR: {
+      auto &n = static_cast<IfElseExpr &>(node);
+      type(n);
+      f(n.cond);
+      break;
+    }
+    case NodeKind::CASE_EXPR: {
+      auto &n = static_cast<CaseExpr &>(node);
+      type(n);
+      f(n.value);
+      pairs(n.cases);
+      break;
+    }
+    case NodeKind::RECORD_EXPR: {
+      auto &n = static_cast<RecordExpr &>(node);
+      type(n);
+      seconds(n.fields);
+      break;
+    }
+    case NodeKind::LIST_EXPR: {
+      auto &n = static_cast<ListExpr &>(node);
+      type(n);
+      each(n.values);
+      if (n.tail) f(n.tail);
+      break;
+    }
+    case NodeKind::MAP_EXPR: {
+      auto &n = static_cast<MapExpr &>(node);
+      type(n);
+      pairs(n.items);
+      break;
+    }
+    case NodeKind::VALUE_EXPR:
+    case NodeKind::SYMBOL_EXPR:
+      type(static_cast<Expr &>(node));
+      break;
+    case NodeKind::CALL_EXPR: {
+      auto &n = static_cast<CallExpr &>(node);
+      type(n);
+      each(n.args);
+      break;
+    }
+    case NodeKind::BIN_OP_EXPR: {
+      auto &n = static_cast<BinOpExpr &>(node);
+      type(n);
+      f(n.lhs);
+      f(n.rhs);
+      break;
+    }
+    case NodeKind::UN_OP_EXPR: {
+      auto &n = static_cast<UnOpExpr &>(node);
+      type(n);
+      f(n.value);
+      break;
+    }
+    case NodeKind::COMPOUND_EXPR: {
+      auto &n = static_cast<CompoundExpr &>(node);
+      type(n);
+      each(n.exprs);
+      break;
+    }
+
+    case NodeKind::DEF_ST: {
+      auto &n = static_cast<DefSt &>(node);
+      type(n);
+      each(n.args);
+      break;
+    }
+    case NodeKind::RECORD_ST:
+      seconds(static_cast<RecordSt &>(node).fields);
+      break;
+    case NodeKind::VAL_ST:
+      f(static_cast<ValSt &>(node).expr);
+      break;
+    case NodeKind::EXPR_ST:
+      f(static_cast<ExprSt &>(node).expr);
+      break;
+    case NodeKind::FOR_ST: {
+      auto &n = static_cast<ForSt &>(node);
+      f(writable(n.pattern));
+      f(n.container);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+template <bool TYPES_ONLY>
+ShareStats share(PT &root, HashCons &table) {
+  ShareStats stats;
+  auto slot = [&](auto *&node) {
+    using T = std::remove_reference_t<decltype(*node)>;
+    if constexpr (TYPES_ONLY && !std::is_same_v<T, Type>) return;
+    // A record type names a record that depends on where it is written,
+    // which is not known until resolve() has run (see Env::make_type).
+    if constexpr (TYPES_ONLY && std::is_same_v<T, Type>)
+      if (node->tag == NodeKind::RECORD_TYPE) return;
+    stats.slots++;
+    T *canonical = table.share(node);
+    if (canonical != node) {
+      stats.shared++;
+      node = canonical;
+    }
+  };
+  // Children are left before their parent, so by the time a node's slots
+  // are shared everything below them already is.
+  walk_iterative(&root, [](PT &) { return true; }, [&slot](PT &node) { for_each_slot(node, slot); });
+  return stats;
+}
+
+} // namespace
+
+HashCons::HashCons() : slots(INITIAL_SLOTS, Slot{ 0, nullptr }) {}
+
+bool HashCons::contains(const PT *node) const {
+  if (!node->hash) return false;
+  size_t mask = slots.size() - 1;
+  for (size_t i = node->hash & mask; slots[i].node; i = (i + 1) & mask)
+    if (slots[i].node == node) return true;
+  return false;
+}
+
+PT *HashCons::share_node(PT *node) {
+  size_t locals;
+  if (!make_key(key, locals, *node)) return node;
+  // A `hash` only says that some table holds the child.
+  for (size_t i = locals; i < key.size(); i++)
+    if (!contains(reinterpret_cast<const PT *>(key[i]))) return node;
+
+  // Children are hashed by structure rather than by address, so the hash of
+  // a tree is the same from one run to the next.
+  uint64_t h = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i < key.size(); i++)
+    h = mix(h, i < locals ? key[i] : reinterpret_cast<const PT *>(key[i])->hash);
+
+  uint32_t folded = fold(h);
+  size_t mask = slots.size() - 1;
+  for (size_t i = folded & mask;; i = (i + 1) & mask) {
+    Slot &slot = slots[i];
+    if (!slot.node) break;
+    if (slot.node == node) return node;
+    if (slot.hash == h && make_key(other, locals, *slot.node) && other == key) return slot.node;
+  }
+
+  // The node may be canonical in another table too; its hash is the same
+  // there.
+  node->hash = folded;
+  if ((count + 1) * 2 > slots.size()) grow();
+  mask = slots.size() - 1;
+  size_t i = folded & mask;
+  while (slots[i].node) i = (i + 1) & mask;
+  slots[i] = { h, node };
+  count++;
+  return node;
+}
+
+void HashCons::grow() {
+  vector<Slot> old(slots.size() * 2, Slot{ 0, nullptr });
+  old.swap(slots);
+  size_t mask = slots.size() - 1;
+  for (auto it = old.begin(); it != old.end(); it++) {
+    if (!it->node) continue;
+    size_t i = fold(it->hash) & mask;
+    while (slots[i].node) i = (i + 1) & mask;
+    slots[i] = *it;
+  }
+}
+
+ShareStats share_subtrees(PT &root, HashCons &table) { return share<false>(root, table); }
+
+ShareStats share_types(PT &root, HashCons &table) { return share<true>(root, table); }
+
+} // namespace dasl::pt
@@ -0,0 +1,82 @@
+#ifndef HASH_CONS_HXX
+#define HASH_CONS_HXX
+
+#include <cstdint>
+#include <vector>
+using std::vector;
+
+#include "parse_tree.hxx"
+
+// Hash consing: structurally equal nodes are replaced by one canonical node,
+// so two shared subtrees are equal exactly when their pointers are, and
+// passes that compare types or deduplicate expressions need not look inside
+// them.
+//
+// What can be shared is every Type, and the Expr and Pat subtrees built only
+// from values, symbols, operators, calls and list, map and record
+// constructors whose children are shared as well. Ifs, cases and compound
+// expressions hold statements or scopes and are always left alone, but
+// their children are shared.
+//
+// A shared node stands for every place it occurs, so its span is that of
+// the first occurrence; run passes that report diagnostics before sharing.
+// Nodes must not be changed in place while a table refers to them.
+namespace dasl::pt {
+
+// Canonical nodes, found by structure. A node is canonical in a table once
+// its share() has returned it, and has its structural hash in `PT::hash`
+// from then on; children are compared by pointer, so they must be canonical
+// in the same table before their parent is shared. A node may be canonical
+// in several tables. The table only refers to nodes, which stay in the arena
+// they came from and must outlive it.
+//
+// Open addressing with linear probing, like the Interner, but for one thread.
+class HashCons {
+  struct Slot {
+    uint64_t hash;
+    PT *node;
+  };
+
+  vector<Slot> slots;
+  size_t count = 0;
+  // Keys of the node being shared and of a candidate (see hash_cons.cxx).
+  vector<uint64_t> key, other;
+
+  PT *share_node(PT *node);
+  void grow();
+
+ public:
+  HashCons();
+
+  // Returns the canonical node structurally equal to `node`; `node` becomes
+  // canonical itself if there is none yet. Nodes that cannot be shared, or
+  // that have a child that is not canonical, are returned unchanged.
+  Type *share(Type *type) { return static_cast<Type *>(share_node(type)); }
+  Pat *share(Pat *pat) { return static_cast<Pat *>(share_node(pat)); }
+  Expr *share(Expr *expr) { return static_cast<Expr *>(share_node(expr)); }
+
+  // Whether `node` is canonical in this table.
+  bool contains(const PT *node) const;
+
+  // Number of canonical nodes.
+  size_t size() const { return count; }
+};
+
+struct ShareStats {
+  // Slots looked at, and those now pointing at a node shared with an
+  // earlier one.
+  size_t slots = 0;
+  size_t shared = 0;
+};
+
+// Points every Type, Pat and Expr slot below `root` at its canonical node,
+// bottom up. Walks with an explicit stack, so any depth is fine.
+ShareStats share_subtrees(PT &root, HashCons &table);
+
+// Same, for type annotations only, leaving out record types: equal names
+// may resolve to different records, so the tree may still be resolved.
+ShareStats share_types(PT &root, HashCons &table);
+
+} // namespace dasl::pt
+
+#endif // HASH_CONS_HXX
@@ -0,0 +1,173 @@
+#include "incremental.hxx"
+
+#include <algorithm>
+#include <iterator>
+
+#include "driver.hxx"
+#include "lexer.hxx"
+
+namespace dasl {
+
+using kind = Parser::symbol_kind;
+
+static bool starts_statement(Parser::symbol_kind_type k) {
+  return k == kind::S_KW_VAL || k == kind::S_KW_DEF || k == kind::S_KW_TYPE || k == kind::S_KW_MODULE;
+}
+
+static bool opens_block(Parser::symbol_kind_type k) {
+  return k == kind::S_KW_DEF || k == kind::S_KW_MODULE || k == kind::S_KW_IF;
+}
+
+IncrementalParser::IncrementalParser(Interner &interner, const string *filename)
+    : interner(interner), filename(filename) {}
+
+void IncrementalParser::reset(string_view source) {
+  text.assign(source.data(), source.size());
+  reparse();
+}
+
+void IncrementalParser::reparse() {
+  statements.clear();
+  envs.clear();
+  failed = 0;
+  relex(0, 0, 0, 0);
+}
+
+void IncrementalParser::edit(size_t begin, size_t end, string_view replacement) {
+  end = std::min(end, text.size());
+  begin = std::min(begin, end);
+  // An unterminated string makes the lexer look ahead to the end of the
+  // input, so while there are errors a quote can change tokens before it.
+  bool quote = replacement.find('"') != string_view::npos || text.find('"', begin) < end;
+  text.replace(begin, end - begin, replacement);
+
+  envs.erase(std::remove_if(envs.begin(), envs.end(), [](auto &e) { return e.expired(); }), envs.end());
+  if ((failed && quote) || envs.size() >= MAX_ENVS) {
+    reparse();
+    return;
+  }
+
+  // Re-lex from the statement holding `begin`. If the edit reaches into its
+  // first token the statement may join the one before, so start there.
+  auto after = std::upper_bound(statements.begin(), statements.end(), begin,
+                                [](size_t at, const Statement &s) { return at < s.begin; });
+  size_t first = after == statements.begin() ? 0 : after - statements.begin() - 1;
+  if (first > 0 && begin <= statements[first].begin + statements[first].tokens[0].end) first--;
+
+  size_t sync = first + 1;
+  while (sync < statements.size() && statements[sync].begin < end)
+    sync++;
+  relex(first, sync, begin + replacement.size(), ptrdiff_t(replacement.size()) - ptrdiff_t(end - begin));
+}
+
+// Lexes from the start of statement `first` and splits the tokens into
+// statements, until a statement starts where old statement `sync` or a later
+// one would now start. Past `clean_from` the source is unchanged but moved by
+// `delta`, so from such a statement on the old ones are still valid.
+void IncrementalParser::relex(size_t first, size_t sync, size_t clean_from, ptrdiff_t delta) {
+  size_t from = first == 0 ? 0 : statements[first].begin;
+  Lexer lexer(interner);
+  lexer.set_input(string_view(text).substr(from));
+
+  vector<Statement> fresh;
+  bool synced = false;
+  int depth = 0;
+  last_relexed = 0;
+  for (;;) {
+    Parser::symbol_kind_type k = lexer.get_next_token().kind();
+    if (k == kind::S_YYEOF) break;
+    size_t begin = from + lexer.token_start;
+
+    if (depth == 0 && begin >= clean_from) {
+      while (sync < statements.size() && ptrdiff_t(statements[sync].begin) + delta < ptrdiff_t(begin))
+        sync++;
+      if (sync < statements.size() && ptrdiff_t(statements[sync].begin) + delta == ptrdiff_t(begin)) {
+        synced = true;
+        break;
+      }
+    }
+
+    if (fresh.empty() || (depth == 0 && starts_statement(k))) {
+      fresh.emplace_back();
+      fresh.back().begin = begin;
+    }
+    Statement &s = fresh.back();
+    s.tokens.push_back({ uint32_t(begin - s.begin), uint32_t(from + lexer.m_location - s.begin), k });
+    if (opens_block(k)) depth++;
+    else if (k == kind::S_KW_END) depth--;
+    last_relexed++;
+  }
+
+  size_t last = synced ? sync : statements.size();
+  for (size_t s = first; s < last; s++)
+    if (statements[s].failed()) failed--;
+  for (size_t s = last; s < statements.size(); s++)
+    statements[s].begin += delta;
+  auto at = statements.erase(statements.begin() + first, statements.begin() + last);
+  statements.insert(at, std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end()));
+  parse_statements(first, first + fresh.size());
+}
+
+void IncrementalParser::parse_statements(size_t first, size_t last) {
+  last_reparsed = last - first;
+  if (first == last) return;
+
+  auto env = std::make_shared<pt::Env>(interner);
+  envs.push_back(env);
+  string_view source(text);
+
+  // Usually everything parses, and one pass over the whole span will do.
+  size_t begin = statements[first].begin;
+  if (parse_source(source.substr(begin, statement_end(last - 1) - begin), *env, filename) &&
+      env->errors.empty() && env->pt->statements.size() == last - first) {
+    for (size_t s = first; s < last; s++) {
+      statements[s].st = env->pt->statements[s - first];
+      statements[s].env = env;
+      statements[s].offset = statements[s].begin - begin;
+    }
+    return;
+  }
+
+  // Otherwise parse them one at a time, so each gets its own diagnostics.
+  for (size_t s = first; s < last; s++) {
+    Statement &st = statements[s];
+    env->pt = nullptr;
+    env->errors.clear();
+    bool ok = parse_source(source.substr(st.begin, statement_end(s) - st.begin), *env, filename);
+    st.st = ok && env->pt->statements.size() == 1 ? env->pt->statements[0] : nullptr;
+    st.env = env;
+    st.errors = std::move(env->errors);
+    if (st.failed()) failed++;
+  }
+}
+
+vector<pt::Diagnostic> IncrementalParser::errors() const {
+  vector<pt::Diagnostic> all;
+  if (statements.empty())
+    all.push_back({ Span{}, "syntax error, unexpected end of file" });
+  for (auto &s : statements) {
+    for (auto d : s.errors) {
+      d.span.begin += s.begin;
+      d.span.end += s.begin;
+      all.push_back(std::move(d));
+    }
+  }
+  return all;
+}
+
+vector<IncrementalParser::Parsed> IncrementalParser::parsed() const {
+  vector<Parsed> all;
+  for (auto &s : statements)
+    if (s.st) all.push_back({ s.st, size_t(s.begin) - s.offset });
+  return all;
+}
+
+void IncrementalParser::print(pt::Printer &p) const {
+  for (auto &s : statements) {
+    if (!s.st) continue;
+    s.st->print(p);
+    p << '\n';
+  }
+}
+
+} // namespace dasl
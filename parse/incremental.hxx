@@ -0,0 +1,115 @@
+#ifndef INCREMENTAL_HXX
+#define INCREMENTAL_HXX
+
+#include <memory>
+#include <string>
+using std::string;
+#include <string_view>
+using std::string_view;
+#include <vector>
+using std::vector;
+
+#include <parser.hxx>
+#include "interner.hxx"
+#include "parse_tree.hxx"
+#include "printer.hxx"
+
+namespace dasl {
+
+// Keeps the parse of a source up to date while it is being edited.
+//
+// The source is split into top level statements by a scan over its tokens:
+// a statement starts at every `val`, `def`, `type` or `module` that is not
+// nested in a def, module or if. An edit re-lexes from the start of the
+// statement it falls in until the token stream lines up with the old one
+// again at a statement boundary, and reparses only the statements in between. All other
+// statements keep their trees, and since their tokens, diagnostics and spans
+// are stored relative to their start, moving one only updates that start.
+class IncrementalParser {
+ public:
+  explicit IncrementalParser(Interner &interner, const string *filename = nullptr);
+
+  // Lexes and parses `source` from scratch.
+  void reset(string_view source);
+
+  // Replaces bytes [begin, end) of the source with `replacement` and brings
+  // the statements up to date.
+  void edit(size_t begin, size_t end, string_view replacement);
+
+  const string &source() const { return text; }
+  size_t size() const { return statements.size(); }
+
+  // True if every statement parsed without diagnostics, which is when
+  // parse_source would accept the whole source.
+  bool ok() const { return !statements.empty() && failed == 0; }
+
+  // Diagnostics of all statements, with spans relative to the source.
+  vector<pt::Diagnostic> errors() const;
+
+  // Line starts of the current source, for printing errors(). Built on
+  // demand, since edits would otherwise have to keep it up to date.
+  LineTable lines() const { return LineTable(text, filename); }
+
+  // Prints the statements that parsed, like Program::print.
+  void print(pt::Printer &p) const;
+
+  // A statement that parsed. Its nodes keep the spans they were parsed with
+  // across edits: a node at `span` is at bytes [base + span.begin,
+  // base + span.end) of source().
+  struct Parsed {
+    const pt::St *st;
+    size_t base;
+  };
+  // The statements that parsed, in source order.
+  vector<Parsed> parsed() const;
+
+  // Work done by the last reset() or edit().
+  size_t relexed_tokens() const { return last_relexed; }
+  size_t reparsed_statements() const { return last_reparsed; }
+
+ private:
+  // Offsets are relative to the start of the statement holding the token.
+  struct Token {
+    uint32_t begin, end;
+    Parser::symbol_kind_type kind;
+  };
+
+  struct Statement {
+    uint32_t begin = 0;
+    vector<Token> tokens;
+    pt::St *st = nullptr;
+    // Owns `st`. Statements reparsed together share an Env, which is freed
+    // once the last of them is replaced.
+    std::shared_ptr<pt::Env> env;
+    // Spans in `errors` are relative to the start of the statement. Those in
+    // `st` are relative to `offset` bytes before it: statements parsed in one
+    // piece share the origin of the first of them.
+    vector<pt::Diagnostic> errors;
+    uint32_t offset = 0;
+
+    bool failed() const { return !st || !errors.empty(); }
+  };
+
+  // A full reparse is done instead of an edit once this many Envs are alive,
+  // so a long editing session does not pin one arena per edited statement.
+  static constexpr size_t MAX_ENVS = 64;
+
+  Interner &interner;
+  const string *filename;
+  string text;
+  vector<Statement> statements;
+  vector<std::weak_ptr<pt::Env>> envs;
+  size_t failed = 0;
+  size_t last_relexed = 0, last_reparsed = 0;
+
+  size_t statement_end(size_t s) const {
+    return s + 1 < statements.size() ? statements[s + 1].begin : text.size();
+  }
+  void reparse();
+  void relex(size_t first, size_t sync, size_t clean_from, ptrdiff_t delta);
+  void parse_statements(size_t first, size_t last);
+};
+
+} // namespace dasl
+
+#endif // INCREMENTAL_HXX
@@ -1,20 +1,161 @@
 #include "interner.hxx"
 
+#include <cstring>
+
+#include "stats.hxx"
+
 namespace dasl {
-Interner::Interner() {}
-istring Interner::get(string& s) {
-  auto it = str_to_istring.find(s);
-  if (it != str_to_istring.end()) {
-    return it->second;
-  } else {
-    istring i = { istring_to_str.size() };
-    str_to_istring[s] = i;
-    istring_to_str.push_back(s);
-    return i;
-  }
-}
-string &Interner::get_string(istring s) {
-  return istring_to_str[s.i];
+
+static constexpr size_t INITIAL_SLOTS = 64;
+
+Interner::Table::Table(size_t size) : mask(size - 1), slots(new std::atomic<uint64_t>[size]) {
+  stats::add(stats::INTERNER_SLOTS_ALLOCATED, size);
+  for (size_t i = 0; i < size; i++)
+    slots[i].store(0, std::memory_order_relaxed);
+}
+
+Interner::Interner() : next_id(0) {
+  for (size_t i = 0; i < SHARDS; i++) {
+    shards[i].tables.push_back(std::make_unique<Table>(INITIAL_SLOTS));
+    shards[i].table.store(shards[i].tables.back().get(), std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < SEGMENTS; i++)
+    segments[i].store(nullptr, std::memory_order_relaxed);
+}
+
+Interner::~Interner() {
+  for (size_t i = 0; i < SEGMENTS; i++)
+    delete[] segments[i].load(std::memory_order_relaxed);
+}
+
+// Eight bytes at a time multiply-xorshift mixing; good enough spread for
+// identifiers and much cheaper than a byte-wise hash on long strings.
+uint64_t Interner::hash(string_view s) {
+  const char *p = s.data();
+  size_t n = s.size();
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+
+  while (n >= 8) {
+    uint64_t k;
+    std::memcpy(&k, p, 8);
+    h = (h ^ k) * 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 31;
+    p += 8;
+    n -= 8;
+  }
+
+  uint64_t k = 0;
+  std::memcpy(&k, p, n);
+  h = (h ^ k) * 0x94d049bb133111ebULL;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  return h ^ (h >> 32);
+}
+
+// Segment k holds ids [F * (2^k - 1), F * (2^(k+1) - 1)) where F is the size
+// of the first segment.
+void Interner::locate(size_t id, size_t &segment, size_t &offset) {
+  size_t v = id + (1 << FIRST_SEGMENT_BITS);
+  segment = 63 - __builtin_clzll(v) - FIRST_SEGMENT_BITS;
+  offset = v - (size_t(1) << (segment + FIRST_SEGMENT_BITS));
+}
+
+const Interner::Entry &Interner::entry(size_t id) const {
+  size_t segment, offset;
+  locate(id, segment, offset);
+  return segments[segment].load(std::memory_order_acquire)[offset];
+}
+
+Interner::Entry &Interner::new_entry(size_t id) {
+  size_t segment, offset;
+  locate(id, segment, offset);
+
+  Entry *entries = segments[segment].load(std::memory_order_acquire);
+  if (entries == nullptr) {
+    // Shards insert independently, so two of them may race to create the
+    // same segment; the loser frees its copy.
+    Entry *fresh = new Entry[size_t(1) << (segment + FIRST_SEGMENT_BITS)];
+    if (segments[segment].compare_exchange_strong(entries, fresh, std::memory_order_acq_rel))
+      entries = fresh;
+    else
+      delete[] fresh;
+  }
+  return entries[offset];
+}
+
+bool Interner::lookup(const Table &table, string_view s, uint32_t hash, istring &out) const {
+  for (size_t i = hash & table.mask;; i = (i + 1) & table.mask) {
+    uint64_t slot = table.slots[i].load(std::memory_order_acquire);
+    if (slot == 0) return false;
+    if (static_cast<uint32_t>(slot >> 32) == hash) {
+      size_t id = static_cast<uint32_t>(slot) - 1;
+      const Entry &e = entry(id);
+      if (e.size == s.size() && std::memcmp(e.data, s.data(), s.size()) == 0) {
+        out = istring { id };
+        return true;
+      }
+    }
+  }
+}
+
+static void insert(std::atomic<uint64_t> *slots, size_t mask, uint64_t slot) {
+  for (size_t i = (slot >> 32) & mask;; i = (i + 1) & mask) {
+    if (slots[i].load(std::memory_order_relaxed) == 0) {
+      slots[i].store(slot, std::memory_order_release);
+      return;
+    }
+  }
+}
+
+Interner::Table *Interner::grow(Shard &shard) {
+  Table *old = shard.table.load(std::memory_order_relaxed);
+  stats::add(stats::INTERNER_GROWS);
+  shard.tables.push_back(std::make_unique<Table>((old->mask + 1) * 2));
+  Table *next = shard.tables.back().get();
+
+  for (size_t i = 0; i <= old->mask; i++) {
+    uint64_t slot = old->slots[i].load(std::memory_order_relaxed);
+    if (slot) insert(next->slots.get(), next->mask, slot);
+  }
+
+  shard.table.store(next, std::memory_order_release);
+  return next;
+}
+
+istring Interner::get(string_view s) {
+  uint64_t h64 = hash(s);
+  uint32_t h = static_cast<uint32_t>(h64);
+  Shard &shard = shards[h64 >> (64 - SHARD_BITS)];
+  istring id;
+
+  if (lookup(*shard.table.load(std::memory_order_acquire), s, h, id)) {
+    stats::add(stats::INTERNER_HITS);
+    return id;
+  }
+
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  // Another thread may have added it between the lookup and the lock.
+  Table *table = shard.table.load(std::memory_order_relaxed);
+  if (lookup(*table, s, h, id)) {
+    stats::add(stats::INTERNER_HITS);
+    return id;
+  }
+  stats::add(stats::INTERNER_MISSES);
+
+  char *data = static_cast<char *>(shard.bytes.allocate(s.size() + 1, 1));
+  std::memcpy(data, s.data(), s.size());
+  data[s.size()] = '\0';
+
+  id = istring { next_id.fetch_add(1, std::memory_order_relaxed) };
+  new_entry(id.i) = Entry { data, static_cast<uint32_t>(s.size()), h };
+
+  // Keep each table at most half full.
+  shard.count++;
+  if (shard.count * 2 > table->mask + 1) table = grow(shard);
+  insert(table->slots.get(), table->mask, (uint64_t(h) << 32) | (id.i + 1));
+
+  return id;
 }
 
 } // namespace dasl
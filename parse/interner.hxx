@@ -1,24 +1,91 @@
 #ifndef INTERNER_HXX
 #define INTERNER_HXX
 
-#include <map>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <string_view>
 using std::string;
+using std::string_view;
+
+#include "arena.hxx"
 
 namespace dasl {
 
 struct istring { size_t i; };
 
+// Maps strings to dense integer ids. One Interner can be shared by any number
+// of threads; ids are global to it, so trees parsed on different threads can
+// be compared and merged by id.
+//
+// Strings are spread over shards by hash. Each shard has an open addressing
+// table (linear probing) whose slots pack an entry's hash next to its id, so
+// a probe only touches string bytes when the hashes already match. Looking up
+// a string that is already interned never takes a lock: tables and entries
+// are published with release stores and tables that have been grown out of
+// are kept alive until the interner goes away. Inserting takes the shard's
+// lock only. String bytes live in per-shard arenas whose blocks never move,
+// which keeps every view returned by get_string() valid for the lifetime of
+// the interner.
 class Interner {
-  std::map<string, istring> str_to_istring;
-  std::vector<string> istring_to_str;
+  struct Entry {
+    const char *data;
+    uint32_t size;
+    uint32_t hash;
+  };
+
+  // Slots hold (hash << 32) | (id + 1); 0 marks an empty slot.
+  struct Table {
+    size_t mask;
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+
+    explicit Table(size_t size);
+  };
+
+  struct Shard {
+    std::mutex lock;
+    std::atomic<Table *> table;
+    // The current table and every table it replaced.
+    std::vector<std::unique_ptr<Table>> tables;
+    size_t count = 0;
+    Arena bytes;
+  };
+
+  // Entries are kept in segments of doubling size that are never moved or
+  // freed, so a reader can index them while another thread appends.
+  static constexpr size_t SHARD_BITS = 4;
+  static constexpr size_t SHARDS = 1 << SHARD_BITS;
+  static constexpr size_t FIRST_SEGMENT_BITS = 10;
+  static constexpr size_t SEGMENTS = 32 - FIRST_SEGMENT_BITS;
+
+  Shard shards[SHARDS];
+  std::atomic<Entry *> segments[SEGMENTS];
+  std::atomic<uint32_t> next_id;
+
+  static void locate(size_t id, size_t &segment, size_t &offset);
+  const Entry &entry(size_t id) const;
+  Entry &new_entry(size_t id);
+  bool lookup(const Table &table, string_view s, uint32_t hash, istring &out) const;
+  Table *grow(Shard &shard);
 
  public:
   Interner();
+  Interner(const Interner &) = delete;
+  Interner &operator=(const Interner &) = delete;
+  ~Interner();
+
+  static uint64_t hash(string_view s);
+
+  istring get(string_view s);
+  string_view get_string(istring s) const {
+    const Entry &e = entry(s.i);
+    return string_view(e.data, e.size);
+  }
 
-  istring get(string& s);
-  string &get_string(istring s);
+  size_t size() const { return next_id.load(std::memory_order_relaxed); }
 };
 
 } // namespace dasl
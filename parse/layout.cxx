@@ -0,0 +1,183 @@
+#include "layout.hxx"
+
+#include "resolve.hxx"
+#include "visit.hxx"
+
+namespace dasl::pt {
+
+uint32_t RecordLayout::slot(istring field) const {
+  auto it = slots.find(field.i);
+  return it == slots.end() ? NO_SLOT : it->second;
+}
+
+const RecordLayout *Layouts::find(uint32_t binding) const {
+  if (binding >= of_binding.size() || of_binding[binding] == NO_LAYOUT) return nullptr;
+  return &records[of_binding[binding]];
+}
+
+namespace {
+
+class LayoutPass {
+  Env &env;
+  const Resolution &resolution;
+  Layouts &out;
+  // Per binding, the layout of the record a val or pattern name is known to
+  // hold, or NO_LAYOUT.
+  vector<uint32_t> known;
+  // The layout of the record each annotated INDEX yields, if it is known.
+  unordered_map<const Expr *, uint32_t> fields;
+
+  string name(istring s) const { return string(env.interner.get_string(s)); }
+
+  void error(Span span, const RecordLayout &layout, istring field) {
+    out.errors.push_back({ span, name(layout.record->name.val) + " has no field " + name(field) });
+  }
+
+  uint32_t layout_of(const Type *type) const {
+    if (!type || type->tag != NodeKind::RECORD_TYPE) return NO_LAYOUT;
+    uint32_t target = static_cast<const RecordType *>(type)->symbol.target;
+    return target == NO_BINDING ? NO_LAYOUT : out.of_binding[target];
+  }
+
+  uint32_t layout_of(const Expr *expr) const {
+    uint32_t l = layout_of(expr->type);
+    if (l != NO_LAYOUT) return l;
+    switch (expr->tag) {
+      case NodeKind::RECORD_EXPR: {
+        uint32_t target = static_cast<const RecordExpr *>(expr)->name.target;
+        return target == NO_BINDING ? NO_LAYOUT : out.of_binding[target];
+      }
+      case NodeKind::SYMBOL_EXPR: {
+        uint32_t target = static_cast<const SymbolExpr *>(expr)->symbol.target;
+        return target == NO_BINDING ? NO_LAYOUT : known[target];
+      }
+      case NodeKind::CALL_EXPR: {
+        uint32_t target = static_cast<const CallExpr *>(expr)->name.target;
+        if (target == NO_BINDING || resolution.bindings[target].kind != Binding::DEF) return NO_LAYOUT;
+        return layout_of(static_cast<const DefSt *>(resolution.bindings[target].node)->type);
+      }
+      case NodeKind::BIN_OP_EXPR: {
+        auto it = fields.find(expr);
+        return it == fields.end() ? NO_LAYOUT : it->second;
+      }
+      default:
+        return NO_LAYOUT;
+    }
+  }
+
+  // A name bound by a pattern holds what the pattern's type says.
+  void bind(const Pat *pat, uint32_t layout) {
+    if (layout == NO_LAYOUT || pat->tag != NodeKind::SYMBOL_PAT) return;
+    uint32_t target = static_cast<const SymbolPat *>(pat)->symbol.target;
+    if (target != NO_BINDING && resolution.bindings[target].kind == Binding::PAT) known[target] = layout;
+  }
+
+  void record_pat(RecordPat &n) {
+    const RecordLayout *layout = n.record_name.target == NO_BINDING ? nullptr : out.find(n.record_name.target);
+    if (!layout) return;
+    n.slots.clear();
+    for (auto it = n.fields.begin(); it != n.fields.end(); it++) {
+      uint32_t slot = layout->slot(it->first.val);
+      if (slot == NO_SLOT)
+        error(it->first.span, *layout, it->first.val);
+      else
+        bind(it->second, layout_of(layout->record->fields[slot].second));
+      n.slots.push_back(slot);
+    }
+  }
+
+  void record_expr(RecordExpr &n) {
+    const RecordLayout *layout = n.name.target == NO_BINDING ? nullptr : out.find(n.name.target);
+    if (!layout) return;
+    n.slots.clear();
+    vector<bool> given(layout->size());
+    for (auto it = n.fields.begin(); it != n.fields.end(); it++) {
+      uint32_t slot = layout->slot(it->first.val);
+      if (slot == NO_SLOT) {
+        error(it->first.span, *layout, it->first.val);
+      } else if (given[slot]) {
+        out.errors.push_back({ it->first.span, "field " + name(it->first.val) + " is given twice" });
+      } else {
+        given[slot] = true;
+      }
+      n.slots.push_back(slot);
+    }
+    for (size_t i = 0; i < given.size(); i++) {
+      istring field = layout->record->fields[i].first.val;
+      // A field declared twice is given in its first slot.
+      if (given[i] || layout->slot(field) != i) continue;
+      out.errors.push_back({ n.span, name(layout->record->name.val) + " is missing field " + name(field) });
+    }
+  }
+
+  void index(BinOpExpr &n) {
+    if (n.op != BinOpExpr::INDEX || n.rhs->tag != NodeKind::VALUE_EXPR) return;
+    const Value &key = static_cast<const ValueExpr *>(n.rhs)->value;
+    if (key.kind != ATOM) return;
+    uint32_t l = layout_of(n.lhs);
+    if (l == NO_LAYOUT) return;
+    const RecordLayout &layout = out.records[l];
+    istring field = std::get<ATOM>(key.value).val;
+    n.slot = layout.slot(field);
+    if (n.slot == NO_SLOT) {
+      error(n.rhs->span, layout, field);
+      return;
+    }
+    uint32_t inner = layout_of(layout.record->fields[n.slot].second);
+    if (inner != NO_LAYOUT) fields.emplace(&n, inner);
+  }
+
+  void leave(PT &node) {
+    switch (node.tag) {
+      case NodeKind::SYMBOL_PAT: {
+        auto &n = static_cast<SymbolPat &>(node);
+        bind(&n, layout_of(n.type));
+        break;
+      }
+      case NodeKind::RECORD_PAT:
+        record_pat(static_cast<RecordPat &>(node));
+        break;
+      case NodeKind::RECORD_EXPR:
+        record_expr(static_cast<RecordExpr &>(node));
+        break;
+      case NodeKind::BIN_OP_EXPR:
+        index(static_cast<BinOpExpr &>(node));
+        break;
+      case NodeKind::VAL_ST: {
+        auto &n = static_cast<ValSt &>(node);
+        if (n.binding != NO_BINDING) known[n.binding] = layout_of(n.expr);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+ public:
+  LayoutPass(Env &env, const Resolution &resolution, Layouts &out)
+    : env(env), resolution(resolution), out(out), known(resolution.bindings.size(), NO_LAYOUT) {}
+
+  void run() {
+    out.of_binding.assign(resolution.bindings.size(), NO_LAYOUT);
+    for (size_t i = 0; i < resolution.bindings.size(); i++) {
+      const Binding &b = resolution.bindings[i];
+      if (b.kind != Binding::RECORD) continue;
+      out.of_binding[i] = out.records.size();
+      out.records.push_back({ static_cast<const RecordSt *>(b.node), {} });
+      RecordLayout &layout = out.records.back();
+      auto &fields = layout.record->fields;
+      for (size_t f = 0; f < fields.size(); f++) {
+        if (!layout.slots.emplace(fields[f].first.val.i, f).second)
+          out.errors.push_back({ fields[f].first.span, "field " + name(fields[f].first.val) + " is declared twice" });
+      }
+    }
+    if (!env.pt) return;
+    walk_iterative(static_cast<PT *>(env.pt), [](PT &) { return true; }, [this](PT &node) { leave(node); });
+  }
+};
+
+} // namespace
+
+void lay_out_records(Env &env, const Resolution &resolution, Layouts &out) { LayoutPass(env, resolution, out).run(); }
+
+} // namespace dasl::pt
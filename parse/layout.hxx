@@ -0,0 +1,60 @@
+#ifndef LAYOUT_HXX
+#define LAYOUT_HXX
+
+#include <cstdint>
+#include <unordered_map>
+using std::unordered_map;
+#include <vector>
+using std::vector;
+
+#include "parse_tree.hxx"
+
+// Record layouts. Every record type gets a fixed layout, one slot per field
+// in declaration order, so a record value is an array of slots and a field
+// is an offset into it rather than an atom looked up at run time.
+//
+// Where the record is known, field accesses are compiled to slots in place:
+// RecordExpr::slots for construction, RecordPat::slots for destructuring
+// and BinOpExpr::slot for indexing by a constant atom, `r[:x]`. A record is
+// known for a record constructor, a name bound by a pattern with a record
+// type or by a val of a known record, a call to a def returning a record
+// type, a field whose declared type is a record, and any expression with a
+// record type annotation. Elsewhere indexing stays dynamic.
+//
+// Field names that the record does not have are diagnosed here, as are
+// fields declared or given twice and constructors that leave a field out.
+namespace dasl::pt {
+
+struct Resolution;
+
+constexpr uint32_t NO_LAYOUT = ~0U;
+
+struct RecordLayout {
+  const RecordSt *record;
+  // Field name to slot; slot i holds `record->fields[i]`.
+  unordered_map<size_t, uint32_t> slots;
+
+  // The slot of `field`, or NO_SLOT.
+  uint32_t slot(istring field) const;
+  size_t size() const { return record->fields.size(); }
+};
+
+struct Layouts {
+  vector<RecordLayout> records;
+  // Per binding of the Resolution, the index of its layout in `records`, or
+  // NO_LAYOUT if it is not a record type.
+  vector<uint32_t> of_binding;
+  vector<Diagnostic> errors;
+
+  // The layout of record binding `binding`, or nullptr.
+  const RecordLayout *find(uint32_t binding) const;
+};
+
+// Lays out the records of env.pt, which `resolution` must be the result of
+// resolve() for, into `out`, which must be empty, and annotates the field
+// accesses it can. Runs in time linear in the size of the tree.
+void lay_out_records(Env &env, const Resolution &resolution, Layouts &out);
+
+} // namespace dasl::pt
+
+#endif // LAYOUT_HXX
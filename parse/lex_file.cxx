@@ -3,6 +3,7 @@ using std::string;
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <cstdlib>
 #include <filesystem>
 namespace fs = std::filesystem;
 
@@ -11,20 +12,7 @@ using std::vector;
 
 #include "lexer.hxx"
 #include <parser.hxx>
-
-vector<char> read_file(std::string p) {
-  std::ifstream file(p, std::ios::binary | std::ios::ate);
-  std::streamsize size = file.tellg();
-  file.seekg(0, std::ios::beg);
-
-  std::vector<char> buffer(size);
-  if (file.read(buffer.data(), size)) {
-    return buffer;
-  }
-
-  std::cout << "Failed to read file " << p << std::endl;
-  exit(1);
-}
+#include "driver.hxx"
 
 vector<string> split_by_lines(string s) {
   std::stringstream ss(s);
@@ -36,11 +24,12 @@ vector<string> split_by_lines(string s) {
   return lines;
 }
 
-vector<string> lex(string program) {
-  std::istringstream input(program);
-  dasl::Lexer lexer;
-  lexer.switch_streams(input, cout);
+vector<string> lex(string_view program, dasl::LexerBackend backend) {
+  dasl::Interner interner;
+  dasl::Lexer lexer(interner, backend);
+  lexer.set_input(program);
   vector<string> lexemes;
+  dasl::stats::Timer timer(dasl::stats::LEX);
   while (1) {
     auto tok = lexer.get_next_token();
     if (tok.kind() != dasl::Parser::token::TOKEN_END) {
@@ -49,17 +38,87 @@ vector<string> lex(string program) {
       break;
     }
   }
+  for (auto it = lexer.errors.begin(); it != lexer.errors.end(); it++)
+    dasl::print_diagnostic(std::cerr, *it, lexer.lines);
   return lexemes;
 }
 
+// Everything the parser and the driver get from a token: kind, value, span
+// and its line and column, and where the lexer says the last match started.
+string describe(const dasl::Parser::symbol_type &tok, const dasl::Lexer &lexer, const dasl::Interner &interner) {
+  std::ostringstream out;
+  dasl::LineTable::Position at = lexer.lines.position(tok.location.begin);
+  out << tok.name() << " " << tok.location << " " << at.line << ":" << at.column << " " << lexer.token_start;
+  switch (tok.kind()) {
+    case dasl::Parser::symbol_kind::S_INT: out << " " << tok.value.as<uint64_t>(); break;
+    case dasl::Parser::symbol_kind::S_FLOAT: out << " " << std::hexfloat << tok.value.as<double>(); break;
+    case dasl::Parser::symbol_kind::S_ID:
+    case dasl::Parser::symbol_kind::S_STRING:
+    case dasl::Parser::symbol_kind::S_ATOM:
+      out << " [" << interner.get_string(tok.value.as<dasl::istring>()) << "]";
+      break;
+    default: break;
+  }
+  return out.str();
+}
+
+// Lexes `program` with both backends and reports the first difference in
+// their tokens, errors or line tables.
+bool diff(string_view program) {
+  dasl::Interner interner;
+  dasl::Lexer flex(interner, dasl::LexerBackend::FLEX), simd(interner, dasl::LexerBackend::SIMD);
+  flex.set_input(program);
+  simd.set_input(program);
+  for (size_t i = 0;; i++) {
+    auto a = flex.get_next_token(), b = simd.get_next_token();
+    string x = describe(a, flex, interner), y = describe(b, simd, interner);
+    if (x != y) {
+      std::cout << "token " << i << ": flex " << x << ", simd " << y << std::endl;
+      return false;
+    }
+    if (a.kind() == dasl::Parser::symbol_kind::S_YYEOF) break;
+  }
+  if (flex.errors.size() != simd.errors.size()) {
+    std::cout << flex.errors.size() << " errors from flex, " << simd.errors.size() << " from simd" << std::endl;
+    return false;
+  }
+  for (size_t i = 0; i < flex.errors.size(); i++) {
+    const dasl::pt::Diagnostic &a = flex.errors[i], &b = simd.errors[i];
+    if (a.span.begin != b.span.begin || a.span.end != b.span.end || a.message != b.message) {
+      std::cout << "error " << i << ": flex " << a.span << " " << a.message << ", simd " << b.span << " "
+                << b.message << std::endl;
+      return false;
+    }
+  }
+  if (flex.lines.lines() != simd.lines.lines()) {
+    std::cout << "line tables differ" << std::endl;
+    return false;
+  }
+  return true;
+}
+
 int main(int argc, char **argv) {
-  if (argc < 2) {
+  // --simd lexes with the hand written backend; --diff lexes with both and
+  // compares them.
+  string mode = argc > 2 ? argv[1] : "";
+  if (argc < 2 || (argc > 2 && mode != "--simd" && mode != "--diff")) {
     std::cout << "ERROR: You must supply a path to program to lex!";
     return 1;
   }
-  std::string path = argv[1];
-    vector<char> prog = read_file(path);
-    vector<string> actual_lexemes = lex(string(prog.begin(), prog.end()));
+  std::string path = argv[argc - 1];
+  std::atexit(dasl::stats::report);
+    dasl::MappedFile prog;
+    if (!prog.open(path)) {
+      std::cout << "Failed to read file " << path << std::endl;
+      return 1;
+    }
+    if (mode == "--diff") {
+      bool same = diff(prog.view());
+      std::cout << (same ? "Passed " : "Failed ") << path << (same ? "!" : "") << std::endl;
+      return same ? 0 : 1;
+    }
+    auto backend = mode == "--simd" ? dasl::LexerBackend::SIMD : dasl::LexerBackend::FLEX;
+    vector<string> actual_lexemes = lex(prog.view(), backend);
     for (int i = 0; i < actual_lexemes.size(); i++)
       std::cout << actual_lexemes[i] << std::endl;
 }
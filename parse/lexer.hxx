@@ -11,23 +11,77 @@
 // Sinice Bison 3 uses symbol_type, we must change returned type. We also rename it
 // to something sane, since you cannot overload return type.
 #undef YY_DECL
-#define YY_DECL dasl::Parser::symbol_type dasl::Lexer::get_next_token()
+#define YY_DECL dasl::Parser::symbol_type dasl::Lexer::scan_token()
 
 #include <parser.hxx>
-#include <location.hh>
+#include "driver.hxx"
+#include "interner.hxx"
+#include "source_map.hxx"
+#include "stats.hxx"
 
 namespace dasl {
 
+// Identifiers, atoms and string literals are interned as they are scanned,
+// so their tokens carry an istring rather than a copy of the text.
+//
+// There are two scanners behind get_next_token(): the one flex generates
+// from lexer.l, and a hand written one (simd_lexer.cxx) that skips
+// whitespace and scans ids, numbers and strings a vector register at a time.
+// Both produce the same tokens, spans, errors and lines; the second only
+// works on input given to set_input.
 class Lexer : public yyFlexLexer {
  public:
-  Lexer() {}
+  explicit Lexer(Interner &interner, LexerBackend backend = LexerBackend::FLEX)
+      : interner(interner), backend(backend) {}
   virtual ~Lexer() {}
-  dasl::Parser::symbol_type get_next_token();
+  dasl::Parser::symbol_type get_next_token() {
+    dasl::Parser::symbol_type token = backend == LexerBackend::SIMD && from_memory ? scan_simd() : scan_token();
+    stats::count_token(token.kind());
+    return token;
+  }
+
+  Interner &interner;
+  vector<pt::Diagnostic> errors;
 
   void increase_location(int i) { m_location += i; }
 
+  // Scan `source` directly instead of the input stream. The bytes are only
+  // copied into flex's own buffer, so this is the cheapest way to lex a
+  // MappedFile. `source` must outlive the scan. If `source` is part of a
+  // larger input that starts `offset` bytes earlier, spans and lines are
+  // counted from the start of that input.
+  void set_input(string_view source, uint32_t offset = 0) {
+    input = source;
+    from_memory = true;
+    base = offset;
+    m_location = token_start = offset;
+  }
+
+  // Scan whatever can be read from `fd`, a chunk at a time. Unlike the
+  // stream, a read returns as soon as some input is available, so tokens
+  // from a pipe are produced while the writer is still going.
+  void set_input_fd(int fd) { input_fd = fd; }
+
   int m_location = 0;
-  dasl::location location;
+  // Byte offset of the last token returned, counted from the start of the
+  // input.
+  int token_start = 0;
+  // Start of every line seen so far.
+  LineTable lines;
+
+ protected:
+  // The scanner generated from lexer.l.
+  dasl::Parser::symbol_type scan_token();
+  // The hand written scanner, reading `input` at m_location.
+  dasl::Parser::symbol_type scan_simd();
+  int LexerInput(char *buf, int max_size) override;
+
+ private:
+  LexerBackend backend;
+  string_view input;
+  uint32_t base = 0;
+  bool from_memory = false;
+  int input_fd = -1;
 };
 
 } // namespace dasl
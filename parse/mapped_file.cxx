@@ -0,0 +1,66 @@
+#include "mapped_file.hxx"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stats.hxx"
+
+namespace dasl {
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const string &path) {
+  // Pages of a mapping are only read in as they are touched, so for mapped
+  // files most of the reading shows up in the lex phase.
+  stats::Timer timer(stats::READ);
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    size = st.st_size;
+    if (size == 0) {
+      ::close(fd);
+      return true;
+    }
+
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      size = 0;
+      return false;
+    }
+    madvise(p, size, MADV_SEQUENTIAL);
+    data = static_cast<const char *>(p);
+    mapped = true;
+    return true;
+  }
+
+  char chunk[1 << 16];
+  ssize_t n;
+  while ((n = read(fd, chunk, sizeof chunk)) > 0)
+    buffer.insert(buffer.end(), chunk, chunk + n);
+  ::close(fd);
+  if (n < 0) {
+    buffer.clear();
+    return false;
+  }
+
+  data = buffer.data();
+  size = buffer.size();
+  return true;
+}
+
+void MappedFile::close() {
+  if (mapped) munmap(const_cast<char *>(data), size);
+  mapped = false;
+  data = nullptr;
+  size = 0;
+  buffer.clear();
+}
+
+} // namespace dasl
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_HXX
+#define MAPPED_FILE_HXX
+
+#include <string>
+using std::string;
+#include <string_view>
+using std::string_view;
+#include <vector>
+
+namespace dasl {
+
+// Read-only view of a whole file. Regular files are memory mapped so their
+// bytes are never copied into the process; anything that cannot be mapped
+// (pipes, character devices) is read into an owned buffer instead.
+class MappedFile {
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::vector<char> buffer;
+
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  // Returns false if the file could not be opened or read.
+  bool open(const string &path);
+  void close();
+
+  string_view view() const { return string_view(data, size); }
+};
+
+} // namespace dasl
+
+#endif // MAPPED_FILE_HXX
@@ -0,0 +1,453 @@
+#include "match.hxx"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#include "visit.hxx"
+
+namespace dasl::pt {
+
+namespace {
+
+uint64_t value_bits(const Value &v) {
+  switch (v.kind) {
+    case STRING: return std::get<STRING>(v.value).val.i;
+    case ATOM: return std::get<ATOM>(v.value).val.i;
+    case INT: return std::get<INT>(v.value);
+    case BOOL: return std::get<BOOL>(v.value);
+    case FLOAT: {
+      uint64_t bits;
+      double f = std::get<FLOAT>(v.value);
+      std::memcpy(&bits, &f, sizeof bits);
+      return bits;
+    }
+    case UNIT: return 0;
+  }
+  return 0;
+}
+
+bool same_symbol(const SymbolRef &a, const SymbolRef &b) {
+  if (a.name.val.i != b.name.val.i || a.modules.size() != b.modules.size()) return false;
+  for (size_t i = 0; i < a.modules.size(); i++)
+    if (a.modules[i].val.i != b.modules[i].val.i) return false;
+  return true;
+}
+
+bool same_ctor(const MatchCtor &a, const MatchCtor &b) {
+  if (a.kind != b.kind) return false;
+  if (a.kind == MatchCtor::VALUE) return a.value_kind == b.value_kind && a.bits == b.bits;
+  if (a.kind == MatchCtor::RECORD) return same_symbol(*a.record, *b.record);
+  return true;
+}
+
+bool ctor_less(const MatchCtor &a, const MatchCtor &b) {
+  if (a.kind != b.kind) return a.kind < b.kind;
+  if (a.kind == MatchCtor::RECORD) return a.record->name.val.i < b.record->name.val.i;
+  if (a.value_kind != b.value_kind) return a.value_kind < b.value_kind;
+  if (a.value_kind == INT) return int64_t(a.bits) < int64_t(b.bits);
+  return a.bits < b.bits;
+}
+
+// Pattern `pat` still has to match the value at `access`. A null `pat`
+// means the map key `access` has to be present; for list patterns only the
+// elements from `index` on are left.
+struct Constraint {
+  uint32_t access;
+  const Pat *pat;
+  uint32_t index;
+};
+
+struct Row {
+  vector<Constraint> todo;
+  vector<MatchBinding> bindings;
+  uint32_t arm;
+};
+
+struct Job {
+  vector<Row> rows;
+  uint32_t node;
+};
+
+enum Test { CTOR, PRESENT, GUARD, NONE };
+
+class Compiler {
+  MatchTree &tree;
+  size_t max_nodes;
+  std::map<std::tuple<uint32_t, uint8_t, uint8_t, uint64_t>, uint32_t> access_ids;
+  vector<Job> jobs;
+
+  uint32_t access(uint32_t parent, MatchAccess::Step step, istring field = istring{ 0 },
+                  const Value *key = nullptr) {
+    auto id = std::make_tuple(parent, uint8_t(step), uint8_t(key ? key->kind : UNIT),
+                              key ? value_bits(*key) : field.i);
+    auto it = access_ids.find(id);
+    if (it != access_ids.end()) return it->second;
+    tree.accesses.push_back({ step, parent, field, key });
+    return access_ids[id] = tree.accesses.size() - 1;
+  }
+
+  uint32_t reserve(vector<Row> rows) {
+    tree.nodes.emplace_back();
+    jobs.push_back({ std::move(rows), uint32_t(tree.nodes.size() - 1) });
+    return tree.nodes.size() - 1;
+  }
+
+  static Test classify(const Constraint &c, MatchCtor &ctor) {
+    if (!c.pat) return PRESENT;
+    switch (c.pat->tag) {
+      case NodeKind::VALUE_PAT: {
+        const Value &v = static_cast<const ValuePat *>(c.pat)->value;
+        ctor = { MatchCtor::VALUE, v.kind, value_bits(v), &v, nullptr };
+        return CTOR;
+      }
+      case NodeKind::SYMBOL_PAT:
+        return static_cast<const SymbolPat *>(c.pat)->symbol.modules.empty() ? NONE : GUARD;
+      case NodeKind::RECORD_PAT:
+        ctor = { MatchCtor::RECORD, UNIT, 0, nullptr, &static_cast<const RecordPat *>(c.pat)->record_name };
+        return CTOR;
+      case NodeKind::LIST_PAT: {
+        auto *list = static_cast<const ListPat *>(c.pat);
+        if (c.index == list->pats.size() && list->tail) return NONE;
+        ctor = { c.index < list->pats.size() ? MatchCtor::CONS : MatchCtor::NIL };
+        return CTOR;
+      }
+      case NodeKind::MAP_PAT: {
+        auto &entries = static_cast<const MapPat *>(c.pat)->entries;
+        for (auto it = entries.begin(); it != entries.end(); it++)
+          if (it->first->tag != NodeKind::VALUE_PAT) return GUARD;
+        ctor = { MatchCtor::MAP };
+        return CTOR;
+      }
+      default:
+        return GUARD;
+    }
+  }
+
+  static bool same_guard(const Pat *a, const Pat *b) {
+    if (a == b) return true;
+    auto *x = node_cast<SymbolPat>(a), *y = node_cast<SymbolPat>(b);
+    return x && y && same_symbol(x->symbol, y->symbol);
+  }
+
+  // Drops the constraints that every value meets, binding symbols on the
+  // way, and moves list tails to the access of the list they are the rest
+  // of.
+  static void normalize(Row &row) {
+    MatchCtor ctor;
+    for (size_t i = 0; i < row.todo.size();) {
+      Constraint &c = row.todo[i];
+      if (!c.pat || classify(c, ctor) != NONE) {
+        i++;
+      } else if (auto *symbol = node_cast<SymbolPat>(c.pat)) {
+        row.bindings.push_back({ symbol->symbol.name.val, c.access });
+        row.todo.erase(row.todo.begin() + i);
+      } else {
+        c = { c.access, static_cast<const ListPat *>(c.pat)->tail, 0 };
+      }
+    }
+  }
+
+  // The first constraint of `row` on `at` that tests a constructor.
+  static int find_ctor(const Row &row, uint32_t at, MatchCtor &ctor) {
+    for (size_t i = 0; i < row.todo.size(); i++)
+      if (row.todo[i].access == at && classify(row.todo[i], ctor) == CTOR) return i;
+    return -1;
+  }
+
+  // Replaces constraint `i` of `row`, which tests for `ctor`, with
+  // constraints on the parts of the value.
+  void specialize(Row &row, size_t i, const MatchCtor &ctor) {
+    Constraint c = row.todo[i];
+    vector<Constraint> parts;
+    switch (ctor.kind) {
+      case MatchCtor::RECORD: {
+        auto &fields = static_cast<const RecordPat *>(c.pat)->fields;
+        for (auto it = fields.begin(); it != fields.end(); it++)
+          parts.push_back({ access(c.access, MatchAccess::FIELD, it->first.val), it->second, 0 });
+        break;
+      }
+      case MatchCtor::CONS: {
+        auto *list = static_cast<const ListPat *>(c.pat);
+        parts.push_back({ access(c.access, MatchAccess::HEAD), list->pats[c.index], 0 });
+        parts.push_back({ access(c.access, MatchAccess::TAIL), list, c.index + 1 });
+        break;
+      }
+      case MatchCtor::MAP: {
+        auto &entries = static_cast<const MapPat *>(c.pat)->entries;
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+          const Value *key = &static_cast<const ValuePat *>(it->first)->value;
+          uint32_t at = access(c.access, MatchAccess::KEY, istring{ 0 }, key);
+          parts.push_back({ at, nullptr, 0 });
+          parts.push_back({ at, it->second, 0 });
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    row.todo.erase(row.todo.begin() + i);
+    row.todo.insert(row.todo.begin() + i, parts.begin(), parts.end());
+  }
+
+  static bool complete(const vector<MatchCtor> &ctors) {
+    bool nil = false, cons = false, yes = false, no = false;
+    for (auto it = ctors.begin(); it != ctors.end(); it++) {
+      if (it->kind != ctors[0].kind && !(it->kind == MatchCtor::NIL || it->kind == MatchCtor::CONS)) return false;
+      nil |= it->kind == MatchCtor::NIL;
+      cons |= it->kind == MatchCtor::CONS;
+      if (it->kind == MatchCtor::VALUE) {
+        if (it->value_kind != ctors[0].value_kind) return false;
+        if (it->value_kind == BOOL) (it->bits ? yes : no) = true;
+      }
+    }
+    switch (ctors[0].kind) {
+      case MatchCtor::NIL:
+      case MatchCtor::CONS: return nil && cons;
+      case MatchCtor::VALUE: return ctors[0].value_kind == UNIT || (yes && no);
+      // Distinct record ctors have distinct names, and there is one map ctor.
+      default: return ctors.size() == 1;
+    }
+  }
+
+  static bool dense(const vector<MatchCtor> &ctors) {
+    ValueKind kind = ctors[0].value_kind;
+    for (auto it = ctors.begin(); it != ctors.end(); it++)
+      if (it->kind != MatchCtor::VALUE || it->value_kind != kind) return false;
+    if ((kind != INT && kind != ATOM) || ctors.size() < 3) return false;
+    uint64_t span = ctors.back().bits - ctors.front().bits;
+    return span < 2 * ctors.size();
+  }
+
+  void build(Job &job) {
+    MatchNode node;
+    vector<Row> &rows = job.rows;
+    for (auto it = rows.begin(); it != rows.end(); it++)
+      normalize(*it);
+
+    if (rows.empty()) {
+      tree.exhaustive = false;
+      tree.nodes[job.node] = node;
+      return;
+    }
+    if (rows[0].todo.empty()) {
+      node.kind = MatchNode::LEAF;
+      node.arm = rows[0].arm;
+      node.first = tree.bindings.size();
+      node.count = rows[0].bindings.size();
+      tree.bindings.insert(tree.bindings.end(), rows[0].bindings.begin(), rows[0].bindings.end());
+      tree.reachable[node.arm] = true;
+      tree.nodes[job.node] = node;
+      return;
+    }
+
+    Constraint first = rows[0].todo[0];
+    node.access = first.access;
+    MatchCtor ctor;
+    switch (classify(first, ctor)) {
+      case PRESENT: {
+        node.kind = MatchNode::PRESENT;
+        vector<Row> yes, no;
+        for (auto it = rows.begin(); it != rows.end(); it++) {
+          Row row = *it;
+          auto present = [&first](const Constraint &c) { return c.access == first.access && !c.pat; };
+          row.todo.erase(std::remove_if(row.todo.begin(), row.todo.end(), present), row.todo.end());
+          if (row.todo.size() == it->todo.size()) no.push_back(row);
+          yes.push_back(std::move(row));
+        }
+        node.yes = reserve(std::move(yes));
+        node.no = reserve(std::move(no));
+        break;
+      }
+      case GUARD: {
+        node.kind = MatchNode::GUARD;
+        node.guard = first.pat;
+        vector<Row> yes, no;
+        for (auto it = rows.begin(); it != rows.end(); it++) {
+          Row row = *it;
+          auto guarded = [&first](const Constraint &c) {
+            return c.access == first.access && c.pat && same_guard(c.pat, first.pat);
+          };
+          row.todo.erase(std::remove_if(row.todo.begin(), row.todo.end(), guarded), row.todo.end());
+          if (row.todo.size() == it->todo.size()) no.push_back(row);
+          yes.push_back(std::move(row));
+        }
+        node.yes = reserve(std::move(yes));
+        node.no = reserve(std::move(no));
+        break;
+      }
+      default: {
+        node.kind = MatchNode::SWITCH;
+        vector<MatchCtor> ctors;
+        MatchCtor c;
+        for (auto it = rows.begin(); it != rows.end(); it++) {
+          if (find_ctor(*it, node.access, c) < 0) continue;
+          auto same = [&c](const MatchCtor &d) { return same_ctor(c, d); };
+          if (std::none_of(ctors.begin(), ctors.end(), same)) ctors.push_back(c);
+        }
+        std::sort(ctors.begin(), ctors.end(), ctor_less);
+        node.dense = dense(ctors);
+
+        vector<MatchCase> cases;
+        for (auto k = ctors.begin(); k != ctors.end(); k++) {
+          vector<Row> branch;
+          for (auto it = rows.begin(); it != rows.end(); it++) {
+            int i = find_ctor(*it, node.access, c);
+            if (i >= 0 && !same_ctor(c, *k)) continue;
+            branch.push_back(*it);
+            if (i >= 0) specialize(branch.back(), i, *k);
+          }
+          cases.push_back({ *k, reserve(std::move(branch)) });
+        }
+        node.first = tree.cases.size();
+        node.count = cases.size();
+        tree.cases.insert(tree.cases.end(), cases.begin(), cases.end());
+
+        if (!complete(ctors)) {
+          vector<Row> rest;
+          for (auto it = rows.begin(); it != rows.end(); it++)
+            if (find_ctor(*it, node.access, c) < 0) rest.push_back(*it);
+          node.no = reserve(std::move(rest));
+        }
+        break;
+      }
+    }
+    tree.nodes[job.node] = node;
+  }
+
+ public:
+  Compiler(MatchTree &tree, size_t max_nodes) : tree(tree), max_nodes(max_nodes) {}
+
+  bool compile(const CaseExpr &expr) {
+    tree = MatchTree();
+    tree.reachable.assign(expr.cases.size(), false);
+    tree.accesses.push_back({});
+
+    vector<Row> rows;
+    for (size_t i = 0; i < expr.cases.size(); i++)
+      rows.push_back({ { { 0, expr.cases[i].first, 0 } }, {}, uint32_t(i) });
+    tree.root = reserve(std::move(rows));
+
+    while (!jobs.empty()) {
+      if (tree.nodes.size() > max_nodes) return false;
+      Job job = std::move(jobs.back());
+      jobs.pop_back();
+      build(job);
+    }
+    return true;
+  }
+};
+
+void print_access(const MatchTree &tree, uint32_t a, Printer &p) {
+  const MatchAccess &access = tree.accesses[a];
+  switch (access.step) {
+    case MatchAccess::ROOT:
+      p << '$';
+      break;
+    case MatchAccess::FIELD:
+      print_access(tree, access.parent, p);
+      p << '.' << access.field;
+      break;
+    case MatchAccess::HEAD:
+    case MatchAccess::TAIL:
+      p << (access.step == MatchAccess::HEAD ? "hd(" : "tl(");
+      print_access(tree, access.parent, p);
+      p << ')';
+      break;
+    case MatchAccess::KEY:
+      print_access(tree, access.parent, p);
+      p << '{';
+      access.key->print(p);
+      p << '}';
+      break;
+  }
+}
+
+void print_ctor(const MatchCtor &ctor, Printer &p) {
+  switch (ctor.kind) {
+    case MatchCtor::VALUE: ctor.value->print(p); break;
+    case MatchCtor::RECORD: ctor.record->print(p); p << " {}"; break;
+    case MatchCtor::NIL: p << "[]"; break;
+    case MatchCtor::CONS: p << "[_ :: _]"; break;
+    case MatchCtor::MAP: p << "{}"; break;
+  }
+}
+
+void print_node(const MatchTree &tree, uint32_t n, Printer &p) {
+  const MatchNode &node = tree.nodes[n];
+  switch (node.kind) {
+    case MatchNode::LEAF:
+      p << "arm " << uint64_t(node.arm);
+      for (uint32_t b = node.first; b < node.first + node.count; b++) {
+        p << (b == node.first ? " with " : ", ") << tree.bindings[b].name << " = ";
+        print_access(tree, tree.bindings[b].access, p);
+      }
+      p << '\n';
+      return;
+    case MatchNode::FAIL:
+      p << "fail\n";
+      return;
+    case MatchNode::SWITCH:
+      p << (node.dense ? "table " : "switch ");
+      print_access(tree, node.access, p);
+      p << '\n';
+      break;
+    case MatchNode::PRESENT:
+      p << "present ";
+      print_access(tree, node.access, p);
+      p << '\n';
+      break;
+    case MatchNode::GUARD:
+      p << "guard ";
+      print_access(tree, node.access, p);
+      p << " is ";
+      node.guard->print(p);
+      p << '\n';
+      break;
+  }
+
+  p.scope_start();
+  if (node.kind == MatchNode::SWITCH) {
+    for (uint32_t c = node.first; c < node.first + node.count; c++) {
+      p.indent();
+      print_ctor(tree.cases[c].ctor, p);
+      p << " => ";
+      print_node(tree, tree.cases[c].next, p);
+    }
+  } else {
+    p.indent();
+    p << "yes => ";
+    print_node(tree, node.yes, p);
+  }
+  if (node.no != NO_MATCH_NODE) {
+    p.indent();
+    p << (node.kind == MatchNode::SWITCH ? "_ => " : "no => ");
+    print_node(tree, node.no, p);
+  }
+  p.scope_end();
+}
+
+} // namespace
+
+bool compile_match(const CaseExpr &expr, MatchTree &tree, size_t max_nodes) {
+  return Compiler(tree, max_nodes).compile(expr);
+}
+
+void check_matches(const PT &root, vector<Diagnostic> &warnings) {
+  MatchTree tree;
+  walk_iterative(&root, [&](const PT &node) {
+    auto *expr = node_cast<CaseExpr>(&node);
+    if (!expr || !compile_match(*expr, tree)) return true;
+    for (size_t arm = 0; arm < expr->cases.size(); arm++)
+      if (!tree.reachable[arm]) warnings.push_back({ expr->cases[arm].first->span, "unreachable case" });
+    if (!tree.exhaustive) warnings.push_back({ expr->span, "case does not cover every value" });
+    return true;
+  });
+}
+
+void print(const MatchTree &tree, Printer &p) {
+  print_node(tree, tree.root, p);
+}
+
+} // namespace dasl::pt
@@ -0,0 +1,114 @@
+#ifndef MATCH_HXX
+#define MATCH_HXX
+
+#include <cstdint>
+#include <vector>
+using std::vector;
+
+#include "parse_tree.hxx"
+
+// Compiles the arms of a CaseExpr into a decision tree, which tests every
+// part of the scrutinee at most once on any path instead of trying the arms
+// one after the other. Unreachable arms and missing cases fall out of the
+// construction.
+//
+// The tree is index based like FlatTree: nodes, cases, accesses and
+// bindings live in parallel vectors of one MatchTree and refer to each other
+// by 32-bit index.
+namespace dasl::pt {
+
+// A path from the scrutinee to a part of it, one step at a time.
+struct MatchAccess {
+  enum Step : uint8_t {
+    ROOT,   // the scrutinee itself
+    FIELD,  // record field `field` of parent
+    HEAD,   // first element of the list parent
+    TAIL,   // the rest of the list parent
+    KEY,    // the value under `key` in the map parent
+  } step = ROOT;
+  uint32_t parent = 0;
+  istring field{ 0 };
+  const Value *key = nullptr;
+};
+
+// What a switch case tests a value for. Values of the same kind compare by
+// `bits`: the int itself, the bits of a float, 0 or 1 for bools and the
+// istring of strings and atoms.
+struct MatchCtor {
+  enum Kind : uint8_t { VALUE, RECORD, NIL, CONS, MAP } kind = VALUE;
+  ValueKind value_kind = UNIT;
+  uint64_t bits = 0;
+  const Value *value = nullptr;
+  const SymbolRef *record = nullptr;
+};
+
+struct MatchCase {
+  MatchCtor ctor;
+  uint32_t next;
+};
+
+struct MatchBinding {
+  istring name;
+  uint32_t access;
+};
+
+constexpr uint32_t NO_MATCH_NODE = ~0U;
+
+struct MatchNode {
+  enum Kind : uint8_t {
+    LEAF,     // arm `arm` matches, with bindings [first, first + count)
+    FAIL,     // no arm matches
+    SWITCH,   // go to the case [first, first + count) matching the value at
+              // `access`, or to `no` if none does
+    PRESENT,  // go to `yes` if the map key `access` is present, else `no`
+    GUARD,    // go to `yes` if the value at `access` matches `guard`, a
+              // test the tree cannot see into (a qualified symbol, or a map
+              // pattern with keys that are not literals), else `no`
+  } kind = FAIL;
+  // SWITCH: there are at least three cases, their keys are all ints or all
+  // atoms and span less than twice as many values as there are cases, so a
+  // table indexed by `key - first key` is a good way to dispatch.
+  bool dense = false;
+  uint32_t access = 0;
+  uint32_t arm = 0;
+  uint32_t first = 0, count = 0;
+  uint32_t yes = NO_MATCH_NODE, no = NO_MATCH_NODE;
+  const Pat *guard = nullptr;
+};
+
+struct MatchTree {
+  vector<MatchNode> nodes;
+  vector<MatchCase> cases;
+  vector<MatchAccess> accesses;
+  vector<MatchBinding> bindings;
+  uint32_t root = NO_MATCH_NODE;
+
+  // Per arm, whether any leaf takes it.
+  vector<bool> reachable;
+  // False if some value reaches a FAIL node.
+  bool exhaustive = true;
+};
+
+// Trees are built by specializing the arms on one test at a time. Arms that
+// do not look at the tested value are copied into every branch, which in
+// rare cases makes the tree exponential in the number of arms; past
+// `max_nodes` compilation gives up and returns false.
+//
+// A position in the scrutinee is assumed to hold values of one type: cases
+// on true and false, on [] and [x :: xs], on a single record name or on maps
+// cover every value without a default branch. Type annotations on patterns
+// are not tested, and a symbol without a module binds whatever is there.
+constexpr size_t MAX_MATCH_NODES = 1 << 16;
+bool compile_match(const CaseExpr &expr, MatchTree &tree, size_t max_nodes = MAX_MATCH_NODES);
+
+// Compiles every CaseExpr under `root` and adds a diagnostic for each arm
+// that can never be taken and for each case that does not cover every
+// value.
+void check_matches(const PT &root, vector<Diagnostic> &warnings);
+
+// Prints `tree` for debugging, one test per line.
+void print(const MatchTree &tree, Printer &p);
+
+} // namespace dasl::pt
+
+#endif // MATCH_HXX
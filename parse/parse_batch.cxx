@@ -0,0 +1,168 @@
+#include <string>
+using std::string;
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cerrno>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+#include <memory>
+using std::unique_ptr;
+using std::make_unique;
+
+#include <vector>
+using std::vector;
+
+#include "driver.hxx"
+#include "parse_cache.hxx"
+#include "work_pool.hxx"
+using dasl::Interner;
+using dasl::pt::Env;
+
+// Parses many .dzl files in parallel. Every file gets its own Lexer, Parser
+// and Env, but all of them share one Interner so the resulting trees can be
+// compared by istring.
+//
+// With -c, files whose contents are in the parse cache are loaded from it
+// instead, and files that parse cleanly are added to it. A loaded tree is
+// flat, with its strings in the shared Interner like those of a parsed one.
+struct ParseResult {
+  string path;
+  unique_ptr<Env> env;
+  unique_ptr<dasl::pt::FlatTree> cached;
+  bool ok = false;
+};
+
+static void usage() {
+  std::cout << "usage: parse_batch [-j threads] [-l list_file] [-c cache_dir [-m cache_mb]] [path...]" << std::endl
+            << "  Directories are searched recursively for .dzl files; a list file" << std::endl
+            << "  holds one path per line." << std::endl;
+}
+
+// Parses a decimal count of at most `max` into `out`.
+static bool parse_count(const char *s, uint64_t max, uint64_t &out) {
+  if (*s < '0' || *s > '9') return false;
+  char *end;
+  errno = 0;
+  unsigned long long n = strtoull(s, &end, 10);
+  if (*end || errno == ERANGE || n > max) return false;
+  out = n;
+  return true;
+}
+
+static void add_path(const string &path, vector<string> &files) {
+  std::error_code ec;
+  if (fs::is_directory(path, ec)) {
+    for (auto it = fs::recursive_directory_iterator(path, ec); it != fs::recursive_directory_iterator(); it.increment(ec))
+      if (it->is_regular_file(ec) && it->path().extension() == ".dzl")
+        files.push_back(it->path().string());
+  } else {
+    files.push_back(path);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t threads = std::thread::hardware_concurrency();
+  vector<string> files;
+  string cache_dir;
+  uint64_t cache_bytes = dasl::ParseCache::DEFAULT_MAX_BYTES;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      uint64_t n;
+      if (!parse_count(argv[++i], SIZE_MAX, n)) {
+        usage();
+        return 1;
+      }
+      threads = n;
+    } else if (arg == "-l" && i + 1 < argc) {
+      std::ifstream list(argv[++i]);
+      string line;
+      while (std::getline(list, line))
+        if (!line.empty()) add_path(line, files);
+    } else if (arg == "-c" && i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (arg == "-m" && i + 1 < argc) {
+      if (!parse_count(argv[++i], UINT64_MAX >> 20, cache_bytes)) {
+        usage();
+        return 1;
+      }
+      cache_bytes <<= 20;
+    } else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else {
+      add_path(arg, files);
+    }
+  }
+
+  if (files.empty()) {
+    usage();
+    return 1;
+  }
+
+  unique_ptr<dasl::ParseCache> cache;
+  if (!cache_dir.empty()) {
+    cache = make_unique<dasl::ParseCache>(cache_dir, cache_bytes);
+    if (!cache->open()) {
+      std::cout << "Cannot use cache directory " << cache_dir << std::endl;
+      return 1;
+    }
+  }
+
+  std::atexit(dasl::stats::report);
+
+  Interner interner;
+  vector<ParseResult> results(files.size());
+
+  {
+    dasl::WorkPool pool(threads);
+    for (size_t i = 0; i < files.size(); i++) {
+      pool.submit([&, i] {
+        ParseResult &r = results[i];
+        r.path = files[i];
+        r.env = make_unique<Env>(interner);
+
+        dasl::MappedFile source;
+        if (!source.open(r.path)) {
+          r.env->lines.filename = &r.path;
+          r.env->errors.push_back({ Span{}, "failed to read file" });
+          return;
+        }
+
+        if (cache) {
+          r.cached = make_unique<dasl::pt::FlatTree>();
+          if (cache->load(source.view(), interner, *r.cached)) {
+            r.env->lines.filename = &r.path;
+            r.ok = true;
+            return;
+          }
+          r.cached.reset();
+        }
+
+        r.ok = dasl::parse_source(source.view(), *r.env, &r.path);
+        if (cache && r.ok && r.env->errors.empty())
+          cache->store(source.view(), dasl::pt::FlatTree(*r.env->pt), interner);
+      });
+    }
+    pool.wait();
+  }
+
+  size_t failed = 0, hits = 0;
+  for (auto it = results.begin(); it != results.end(); it++) {
+    if (it->cached) hits++;
+    if (it->ok && it->env->errors.empty()) continue;
+    failed++;
+    std::cout << "FAILED " << it->path << std::endl;
+    for (auto e = it->env->errors.begin(); e != it->env->errors.end(); e++)
+      dasl::print_diagnostic(std::cout, *e, it->env->lines);
+  }
+
+  std::cout << "Parsed " << results.size() - failed << "/" << results.size() << " files ("
+            << interner.size() << " distinct strings";
+  if (cache) std::cout << ", " << hits << " from cache";
+  std::cout << ")" << std::endl;
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+#include "parse_cache.hxx"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+namespace fs = std::filesystem;
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dasl {
+
+// Two independent 64-bit lanes over the source, 8 bytes at a time. With the
+// length in the name as well, a false hit is not a practical concern.
+static void content_hash(string_view s, uint64_t &a, uint64_t &b) {
+  const char *p = s.data();
+  size_t n = s.size();
+  a = 0x9e3779b97f4a7c15ULL ^ n;
+  b = 0xc2b2ae3d27d4eb4fULL ^ n;
+
+  auto mix = [](uint64_t &x, uint64_t &y, uint64_t k) {
+    x = (x ^ k) * 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 31;
+    y = (y + k) * 0x94d049bb133111ebULL;
+    y ^= y >> 29;
+  };
+
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t k;
+    std::memcpy(&k, p, 8);
+    mix(a, b, k);
+  }
+  uint64_t k = 0;
+  std::memcpy(&k, p, n);
+  mix(a, b, k);
+  mix(a, b, a ^ b);
+}
+
+static bool all_of(string_view s, const char *chars) {
+  return !s.empty() && s.find_first_not_of(chars) == string_view::npos;
+}
+
+// Whether `name` is one entry_path() makes, <32 hex digits>-<hex size>.dast.
+static bool is_entry(string_view name) {
+  static const char HEX[] = "0123456789abcdef";
+  static const string_view SUFFIX = ".dast";
+  if (name.size() <= 33 + SUFFIX.size() || name[32] != '-') return false;
+  if (name.substr(name.size() - SUFFIX.size()) != SUFFIX) return false;
+  return all_of(name.substr(0, 32), HEX) && all_of(name.substr(33, name.size() - 33 - SUFFIX.size()), HEX);
+}
+
+// Whether `name` is a temporary file of store(), .tmp-<pid>-<n>.
+static bool is_tmp(string_view name) {
+  static const string_view PREFIX = ".tmp-";
+  if (name.substr(0, PREFIX.size()) != PREFIX) return false;
+  name.remove_prefix(PREFIX.size());
+  size_t dash = name.find('-');
+  return dash != string_view::npos && all_of(name.substr(0, dash), "0123456789") &&
+         all_of(name.substr(dash + 1), "0123456789");
+}
+
+ParseCache::ParseCache(const string &dir, uint64_t max_bytes) : dir(dir), max_bytes(max_bytes) {}
+
+string ParseCache::entry_path(string_view source) const {
+  uint64_t a, b;
+  content_hash(source, a, b);
+  char name[64];
+  std::snprintf(name, sizeof name, "/%016llx%016llx-%zx.dast", static_cast<unsigned long long>(a),
+                static_cast<unsigned long long>(b), source.size());
+  return dir + name;
+}
+
+bool ParseCache::open() {
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  if (!fs::is_directory(dir, ec)) return false;
+
+  uint64_t total = 0;
+  for (auto it = fs::directory_iterator(dir, ec); it != fs::directory_iterator(); it.increment(ec)) {
+    string name = it->path().filename().string();
+    if (it->is_regular_file(ec) && (is_entry(name) || is_tmp(name))) total += it->file_size(ec);
+  }
+  bytes = total;
+  if (total > max_bytes) evict();
+  return true;
+}
+
+bool ParseCache::load(string_view source, pt::AstFile &out) {
+  string path = entry_path(source);
+  if (!out.open(path)) return false;
+
+  // Marks the entry as recently used for eviction.
+  utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+  return true;
+}
+
+bool ParseCache::load(string_view source, Interner &interner, pt::FlatTree &out) {
+  pt::AstFile file;
+  if (!load(source, file)) return false;
+  file.intern(interner, out);
+  return true;
+}
+
+void ParseCache::store(string_view source, const pt::FlatTree &tree, const Interner &interner) {
+  string path = entry_path(source);
+  string tmp = dir + "/.tmp-" + std::to_string(getpid()) + "-" + std::to_string(next_tmp++);
+  if (!pt::write_ast_file(tmp, tree, interner, "") || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return;
+  }
+
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0) bytes += st.st_size;
+  if (bytes > max_bytes) evict();
+}
+
+// Removes the least recently used entries until the directory is at three
+// quarters of its limit, so eviction does not run again on the next store.
+void ParseCache::evict() {
+  std::unique_lock<std::mutex> guard(evict_lock, std::try_to_lock);
+  if (!guard.owns_lock()) return;
+
+  struct Entry {
+    fs::file_time_type used;
+    uint64_t size;
+    fs::path path;
+  };
+  std::vector<Entry> entries;
+  uint64_t total = 0;
+
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(dir, ec); it != fs::directory_iterator(); it.increment(ec)) {
+    // Only what the cache wrote itself is counted or removed: the directory
+    // may hold other files.
+    string name = it->path().filename().string();
+    bool tmp = is_tmp(name);
+    if (!it->is_regular_file(ec) || !(tmp || is_entry(name))) continue;
+    uint64_t size = it->file_size(ec);
+    total += size;
+    // Temporary files are only evicted once they are clearly abandoned.
+    auto used = it->last_write_time(ec);
+    if (tmp && fs::file_time_type::clock::now() - used < std::chrono::hours(1)) continue;
+    entries.push_back({ used, size, it->path() });
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const Entry &x, const Entry &y) { return x.used < y.used; });
+  for (auto it = entries.begin(); it != entries.end() && total > max_bytes / 4 * 3; it++)
+    if (fs::remove(it->path, ec)) total -= it->size;
+  bytes = total;
+}
+
+} // namespace dasl
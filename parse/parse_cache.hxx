@@ -0,0 +1,61 @@
+#ifndef PARSE_CACHE_HXX
+#define PARSE_CACHE_HXX
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+using std::string;
+#include <string_view>
+using std::string_view;
+
+#include "ast_file.hxx"
+
+namespace dasl {
+
+// On-disk cache of parsed programs, keyed by a hash of the source bytes, so
+// unchanged files are never lexed or parsed twice. Entries are AST files
+// (see ast_file.hxx) named after the hash and length of the source. Files
+// with the same contents share an entry, so entries record no source name;
+// callers name a loaded tree after the file they asked for.
+//
+// Any number of threads and processes can share a directory. Entries are
+// written to a temporary file and renamed into place, so a reader only ever
+// sees complete files, and an entry deleted by another process's eviction
+// stays readable for as long as it is mapped. When the directory grows past
+// `max_bytes` the least recently used entries are removed. Other files in
+// the directory are neither counted nor removed.
+class ParseCache {
+  string dir;
+  uint64_t max_bytes;
+  // Size of the directory as of the last scan plus what was stored since.
+  std::atomic<uint64_t> bytes{ 0 };
+  std::atomic<uint32_t> next_tmp{ 0 };
+  std::mutex evict_lock;
+
+  string entry_path(string_view source) const;
+  void evict();
+
+ public:
+  static constexpr uint64_t DEFAULT_MAX_BYTES = 256 << 20;
+
+  explicit ParseCache(const string &dir, uint64_t max_bytes = DEFAULT_MAX_BYTES);
+
+  // Creates the directory if needed. Returns false if it cannot be used.
+  bool open();
+
+  // Loads the tree for `source` into `out` if there is one. Its strings
+  // index the entry's own string table.
+  bool load(string_view source, pt::AstFile &out);
+  // Same, with the strings interned in `interner`, so the tree compares by
+  // istring with those parsed with it.
+  bool load(string_view source, Interner &interner, pt::FlatTree &out);
+
+  // Adds the tree parsed from `source`. Failures are ignored: the cache only
+  // ever makes things faster.
+  void store(string_view source, const pt::FlatTree &tree, const Interner &interner);
+};
+
+} // namespace dasl
+
+#endif // PARSE_CACHE_HXX
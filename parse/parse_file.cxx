@@ -1,62 +1,78 @@
 #include <string>
 using std::string;
-#include <sstream>
-#include <fstream>
 #include <iostream>
-#include <filesystem>
-namespace fs = std::filesystem;
+#include <cstdlib>
 
-#include <vector>
-using std::vector;
+#include "driver.hxx"
+#include "fold.hxx"
+#include "work_pool.hxx"
 
-#include "lexer.hxx"
-#include <parser.hxx>
+using dasl::pt::Env;
 
-vector<char> read_file(std::string p) {
-  std::ifstream file(p, std::ios::binary | std::ios::ate);
-  std::streamsize size = file.tellg();
-  file.seekg(0, std::ios::beg);
-
-  std::vector<char> buffer(size);
-  if (file.read(buffer.data(), size)) {
-    return buffer;
+int main(int argc, char **argv) {
+  // -O folds constant expressions before printing. -S lexes files with the
+  // SIMD backend and -P parses them on all cores; standard input always
+  // goes through flex on one thread.
+  bool fold = false, parallel = false;
+  auto backend = dasl::LexerBackend::FLEX;
+  int arg = 1;
+  for (; arg < argc - 1; arg++) {
+    if (string(argv[arg]) == "-O") fold = true;
+    else if (string(argv[arg]) == "-S") backend = dasl::LexerBackend::SIMD;
+    else if (string(argv[arg]) == "-P") parallel = true;
+    else break;
   }
+  if (arg != argc - 1) {
+    std::cout << "ERROR: You must supply a path to program to parse!";
+    return 1;
+  }
+  std::string path = argv[arg];
+  std::atexit(dasl::stats::report);
 
-  std::cout << "Failed to read file " << p << std::endl;
-  exit(1);
-}
-
-vector<string> split_by_lines(string s) {
-  std::stringstream ss(s);
-  std::string to;
+  // "-" streams standard input: statements are printed as soon as they have
+  // been parsed and released right after.
+  if (path == "-") {
+    Env env;
+    dasl::pt::Printer printer(env.interner, std::cout);
+    env.stream_statements([&printer, &env, fold](dasl::pt::St &st) {
+      if (fold) dasl::pt::fold_constants(st, env);
+      dasl::stats::Timer timer(dasl::stats::PRINT);
+      st.print(printer);
+      printer << '\n';
+      printer.flush();
+    });
+    bool ok = dasl::parse_fd(0, env, &path);
+    for (auto it = env.errors.begin(); it != env.errors.end(); it++)
+      dasl::print_diagnostic(std::cout, *it, env.lines);
+    if (!ok) {
+      std::cout << "FAILED TO PARSE!" << std::endl;
+      return 1;
+    }
+    return 0;
+  }
 
-  vector<string> lines;
-  while (std::getline(ss, to, '\n'))
-    lines.push_back(to);
-  return lines;
-}
+  dasl::MappedFile prog;
+  if (!prog.open(path)) {
+    std::cout << "Failed to read file " << path << std::endl;
+    return 1;
+  }
 
-string parse(string program) {
-  std::istringstream input(program);
-  dasl::Lexer lexer;
-  lexer.switch_streams(input, cout);
   Env env;
-  dasl::Parser parser(lexer, env);
-  int res = parser.parse();
-  if (res) {
-    std::cout << "FAILED TO PARSE!" << std::endl;
-    exit(1);
+  bool ok;
+  if (parallel) {
+    dasl::WorkPool pool;
+    ok = dasl::parse_source_parallel(prog.view(), env, pool, &path, backend);
+  } else {
+    ok = dasl::parse_source(prog.view(), env, &path, backend);
   }
-  return env.pt->to_string(env);
-}
-
-int main(int argc, char **argv) {
-  if (argc < 2) {
-    std::cout << "ERROR: You must supply a path to program to lex!";
+  for (auto it = env.errors.begin(); it != env.errors.end(); it++)
+    dasl::print_diagnostic(std::cout, *it, env.lines);
+  if (!ok) {
+    std::cout << "FAILED TO PARSE!" << std::endl;
     return 1;
   }
-  std::string path = argv[1];
-  vector<char> prog = read_file(path);
-  string p = parse(string(prog.begin(), prog.end()));
-  std::cout << p;
+  if (fold) dasl::pt::fold_constants(*env.pt, env);
+  dasl::stats::Timer timer(dasl::stats::PRINT);
+  dasl::pt::Printer printer(env.interner, std::cout);
+  env.pt->print(printer);
 }
@@ -0,0 +1,374 @@
+#include <string>
+using std::string;
+#include <string_view>
+using std::string_view;
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <csignal>
+#include <mutex>
+#include <thread>
+
+#include <memory>
+using std::unique_ptr;
+using std::make_unique;
+using std::shared_ptr;
+using std::make_shared;
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "driver.hxx"
+#include "lexer.hxx"
+#include "parse_cache.hxx"
+using dasl::Interner;
+using dasl::pt::Env;
+
+// Serves lex and parse requests from a resident process, so tools that parse
+// many small programs pay for startup once and every request finds the
+// Interner (and, with -c, the parse cache) warm.
+//
+// Requests and responses are a header line followed by exactly as many bytes
+// of payload as the header gives:
+//
+//   request:  <command> <length>\n<source>
+//   response: <status> <length> <micros>\n<payload>
+//
+//   lex     token names, one per line, as printed by test_lexer
+//   parse   the tree, serialized as by serialize_ast (see ast_file.hxx)
+//   print   the tree, printed
+//   stats   request counts and latencies as JSON; the source is ignored
+//
+// The status is `ok`, or `error` with the diagnostics as payload. `micros` is
+// the time spent on the request. With -s the server listens on a Unix socket
+// and serves each connection on its own thread; otherwise it serves a single
+// stream of requests on stdin and stdout.
+//
+// A request longer than the limit set with -r is answered with an error and
+// its connection is closed, since its payload is never read. The Interner is
+// replaced by an empty one once it holds more strings than -i allows, so a
+// long running server does not grow without bound.
+
+enum Command { LEX, PARSE, PRINT, STATS, COMMANDS };
+static const char *command_names[] = { "lex", "parse", "print", "stats" };
+
+struct Counter {
+  uint64_t count = 0;
+  uint64_t errors = 0;
+  uint64_t total_us = 0;
+  uint64_t max_us = 0;
+};
+
+struct Server {
+  static constexpr size_t DEFAULT_MAX_REQUEST = 64 << 20;
+  static constexpr size_t DEFAULT_MAX_STRINGS = 4 << 20;
+
+  size_t max_request = DEFAULT_MAX_REQUEST;
+  size_t max_strings = DEFAULT_MAX_STRINGS;
+  unique_ptr<dasl::ParseCache> cache;
+
+  std::mutex lock;
+  // Requests in flight keep the Interner they started with alive after it
+  // is replaced.
+  shared_ptr<Interner> interner = make_shared<Interner>();
+  Counter counters[COMMANDS];
+  uint64_t cache_hits = 0;
+  uint64_t interner_resets = 0;
+
+  // The Interner for a new request.
+  shared_ptr<Interner> request_interner() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (interner->size() > max_strings) {
+      interner = make_shared<Interner>();
+      interner_resets++;
+    }
+    return interner;
+  }
+
+  void count(Command c, bool ok, uint64_t micros) {
+    std::lock_guard<std::mutex> guard(lock);
+    Counter &counter = counters[c];
+    counter.count++;
+    if (!ok) counter.errors++;
+    counter.total_us += micros;
+    if (micros > counter.max_us) counter.max_us = micros;
+  }
+};
+
+// Buffered reads of framed requests from `in`.
+class Connection {
+  int in, out;
+  size_t max_length;
+  string buffer;
+  size_t pos = 0;
+
+  bool fill() {
+    buffer.erase(0, pos);
+    pos = 0;
+    char chunk[64 * 1024];
+    for (;;) {
+      ssize_t n = read(in, chunk, sizeof chunk);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      buffer.append(chunk, n);
+      return true;
+    }
+  }
+
+ public:
+  enum Read { REQUEST, END, TOO_LONG };
+
+  Connection(int in, int out, size_t max_length) : in(in), out(out), max_length(max_length) {}
+
+  // END at the end of the stream or on a malformed header, TOO_LONG if the
+  // header asks for more than `max_length` bytes, which are not read.
+  Read read_request(string &command, string &payload) {
+    size_t eol;
+    while ((eol = buffer.find('\n', pos)) == string::npos) {
+      if (buffer.size() - pos > 256 || !fill()) return END;
+    }
+    std::istringstream header(buffer.substr(pos, eol - pos));
+    int64_t length;
+    if (!(header >> command >> length) || length < 0) return END;
+    if (uint64_t(length) > max_length) return TOO_LONG;
+    pos = eol + 1;
+
+    while (buffer.size() - pos < size_t(length))
+      if (!fill()) return END;
+    payload.assign(buffer, pos, length);
+    pos += length;
+    return REQUEST;
+  }
+
+  bool write_response(bool ok, string_view payload, uint64_t micros) {
+    string message = (ok ? "ok " : "error ") + std::to_string(payload.size()) + " " + std::to_string(micros) + "\n";
+    message += payload;
+    for (size_t done = 0; done < message.size();) {
+      ssize_t n = write(out, message.data() + done, message.size() - done);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      done += n;
+    }
+    return true;
+  }
+};
+
+static string diagnostics(const vector<dasl::pt::Diagnostic> &errors, const dasl::LineTable &lines) {
+  std::ostringstream out;
+  for (auto it = errors.begin(); it != errors.end(); it++)
+    dasl::print_diagnostic(out, *it, lines);
+  return out.str();
+}
+
+static bool lex(Interner &interner, string_view source, string &out) {
+  dasl::Lexer lexer(interner);
+  lexer.set_input(source);
+  dasl::stats::Timer timer(dasl::stats::LEX);
+  for (;;) {
+    auto tok = lexer.get_next_token();
+    if (tok.kind() == dasl::Parser::symbol_kind::S_YYEOF) break;
+    out += tok.name();
+    out += '\n';
+  }
+  if (lexer.errors.empty()) return true;
+  out = diagnostics(lexer.errors, lexer.lines);
+  return false;
+}
+
+static bool parse(Server &server, Interner &interner, Command command, string_view source, string &out) {
+  if (command == PARSE && server.cache) {
+    dasl::pt::AstFile cached;
+    if (server.cache->load(source, cached)) {
+      out = cached.bytes();
+      std::lock_guard<std::mutex> guard(server.lock);
+      server.cache_hits++;
+      return true;
+    }
+  }
+
+  Env env(interner);
+  if (!dasl::parse_source(source, env) || !env.errors.empty()) {
+    out = diagnostics(env.errors, env.lines);
+    return false;
+  }
+
+  if (command == PRINT) {
+    dasl::stats::Timer timer(dasl::stats::PRINT);
+    dasl::pt::Printer printer(interner);
+    env.pt->print(printer);
+    out = printer.take();
+    return true;
+  }
+
+  dasl::pt::FlatTree tree(*env.pt);
+  vector<char> bytes = dasl::pt::serialize_ast(tree, interner, "");
+  out.assign(bytes.data(), bytes.size());
+  if (server.cache) server.cache->store(source, tree, interner);
+  return true;
+}
+
+static string stats_json(Server &server) {
+  std::lock_guard<std::mutex> guard(server.lock);
+  std::ostringstream out;
+  out << "{\"interned_strings\": " << server.interner->size() << ", \"interner_resets\": " << server.interner_resets
+      << ", \"cache_hits\": " << server.cache_hits;
+  for (int c = 0; c < COMMANDS; c++) {
+    const Counter &counter = server.counters[c];
+    out << ", \"" << command_names[c] << "\": {\"count\": " << counter.count << ", \"errors\": " << counter.errors
+        << ", \"total_us\": " << counter.total_us << ", \"max_us\": " << counter.max_us << "}";
+  }
+  if (dasl::stats::enabled) {
+    out << ", \"front_end\": ";
+    dasl::stats::write_json(out);
+  }
+  out << "}\n";
+  return out.str();
+}
+
+static void serve(Server &server, int in, int out) {
+  Connection connection(in, out, server.max_request);
+  string name, source, response;
+  for (;;) {
+    Connection::Read read = connection.read_request(name, source);
+    if (read == Connection::TOO_LONG) {
+      connection.write_response(false, "request longer than " + std::to_string(server.max_request) + " bytes\n", 0);
+      return;
+    }
+    if (read == Connection::END) return;
+
+    auto start = std::chrono::steady_clock::now();
+    Command command = COMMANDS;
+    for (int c = 0; c < COMMANDS; c++)
+      if (name == command_names[c]) command = Command(c);
+
+    bool ok;
+    response.clear();
+    shared_ptr<Interner> interner = server.request_interner();
+    switch (command) {
+      case LEX: ok = lex(*interner, source, response); break;
+      case PARSE:
+      case PRINT: ok = parse(server, *interner, command, source, response); break;
+      case STATS: ok = true; response = stats_json(server); break;
+      default: ok = false; response = "unknown command " + name + "\n"; break;
+    }
+
+    uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (command != COMMANDS) server.count(command, ok, micros);
+    if (!connection.write_response(ok, response, micros)) return;
+  }
+}
+
+static int listen_on(const string &path) {
+  sockaddr_un addr;
+  if (path.size() >= sizeof addr.sun_path) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  std::memset(&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  // Only a socket left behind by an earlier server is replaced.
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      close(fd);
+      errno = EEXIST;
+      return -1;
+    }
+    unlink(path.c_str());
+  }
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) < 0 || listen(fd, 64) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Parses a decimal count of at most `max` into `out`.
+static bool parse_count(const char *s, uint64_t max, uint64_t &out) {
+  if (*s < '0' || *s > '9') return false;
+  char *end;
+  errno = 0;
+  unsigned long long n = strtoull(s, &end, 10);
+  if (*end || errno == ERANGE || n > max) return false;
+  out = n;
+  return true;
+}
+
+static void usage() {
+  std::cout << "usage: parse_server [-s socket_path] [-c cache_dir [-m cache_mb]] [-r max_request_mb] [-i max_strings]"
+            << std::endl
+            << "  Without -s, requests are read from stdin and answered on stdout." << std::endl;
+}
+
+int main(int argc, char **argv) {
+  string socket_path;
+  string cache_dir;
+  uint64_t cache_bytes = dasl::ParseCache::DEFAULT_MAX_BYTES;
+  Server server;
+  uint64_t n;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-s" && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (arg == "-c" && i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (arg == "-m" && i + 1 < argc && parse_count(argv[i + 1], UINT64_MAX >> 20, cache_bytes)) {
+      cache_bytes <<= 20;
+      i++;
+    } else if (arg == "-r" && i + 1 < argc && parse_count(argv[i + 1], UINT64_MAX >> 20, n)) {
+      server.max_request = n << 20;
+      i++;
+    } else if (arg == "-i" && i + 1 < argc && parse_count(argv[i + 1], UINT64_MAX, n)) {
+      server.max_strings = n;
+      i++;
+    } else {
+      usage();
+      return arg == "-h" || arg == "--help" ? 0 : 1;
+    }
+  }
+
+  if (!cache_dir.empty()) {
+    server.cache = make_unique<dasl::ParseCache>(cache_dir, cache_bytes);
+    if (!server.cache->open()) {
+      std::cerr << "Cannot use cache directory " << cache_dir << std::endl;
+      return 1;
+    }
+  }
+
+  // A client hanging up mid-response must not take the server down.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  if (socket_path.empty()) {
+    serve(server, 0, 1);
+    return 0;
+  }
+
+  int fd = listen_on(socket_path);
+  if (fd < 0) {
+    std::cerr << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+    return 1;
+  }
+  for (;;) {
+    int client = accept(fd, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      std::cerr << "accept: " << std::strerror(errno) << std::endl;
+      return 1;
+    }
+    std::thread([&server, client] {
+      serve(server, client, client);
+      close(client);
+    }).detach();
+  }
+}
@@ -1,4 +1,5 @@
 #include "parse_tree.hxx"
+#include "hash_cons.hxx"
 
 using std::move;
 using std::nullopt;
@@ -12,16 +13,21 @@ using std::nullopt;
 namespace dasl::pt {
 
 PT::PT() {}
+PT::PT(NodeKind tag) : tag(tag) {}
+
+string PT::to_string(Env &env) const {
+  Printer p(env.interner);
+  print(p);
+  return p.take();
+}
 
-void PT::set_location(location &loc) { loc = loc; }
 
-Program::Program(vector<unique_ptr<St>> &statements) : statements(move(statements)) {}
-string Program::to_string(Env &env) const {
-  string s;
+Program::Program(vector<St *> &statements) : ModuleSt(KIND), statements(move(statements)) {}
+void Program::print(Printer &p) const {
   for (auto it = statements.cbegin(); it != statements.cend(); it++) {
-    s += (*it)->to_string(env) + "\n";
+    (*it)->print(p);
+    p << '\n';
   }
-  return s;
 }
 
 }  // namespace dasl::pt
@@ -16,6 +16,7 @@ using std::string;
 #include <memory>
 using std::unique_ptr;
 using std::make_unique;
+#include <functional>
 
 #include <optional>
 using std::optional;
@@ -23,42 +24,123 @@ using std::optional;
 #include <unordered_map>
 using std::unordered_map;
 
-#include "location.hh"
-using dasl::location;
-using dasl::position;
+#include "source_map.hxx"
+using dasl::Span;
+using dasl::LineTable;
 
 #include "interner.hxx"
 using dasl::Interner;
 using dasl::istring;
 
+#include "arena.hxx"
+using dasl::Arena;
+
+#include "flat_tree.hxx"
+#include "printer.hxx"
+#include "stats.hxx"
+
 namespace dasl::pt {
 
 class Program;
+struct PT;
+struct Type;
+struct RecordType;
+class HashCons;
+
+// A SymbolRef or declaration that resolve() has not bound (see resolve.hxx).
+constexpr uint32_t NO_BINDING = ~0U;
+// A record field access that lay_out_records() has not compiled to a slot
+// (see layout.hxx).
+constexpr uint32_t NO_SLOT = ~0U;
+
+struct Diagnostic {
+  Span span;
+  string message;
+};
+
+// Every node of the tree is allocated from `arena` and is owned by it; child
+// pointers between nodes are non-owning. The whole tree is released at once
+// when the Env goes away.
+//
+// If `on_statement` is set the parser runs in streaming mode: each top level
+// statement is handed to it as soon as it has been parsed, and everything
+// allocated for the statement is released from the arena once the callback
+// returns, so `pt` ends up empty and memory use does not grow with the input.
+// Flat mode is streaming mode with a callback that appends to a FlatTree.
+//
+// An Env either owns its Interner or uses one shared with other Envs, e.g.
+// when several files are parsed on different threads.
 struct Env {
-  Interner interner;
-  unique_ptr<Program> pt;
-  int depth = 0;
-
-  string indent();
-  void scope_start();
-  void scope_end();
-};
-
+ private:
+  unique_ptr<Interner> own_interner;
+
+ public:
+  Interner &interner;
+  Arena arena;
+  Program *pt = nullptr;
+  std::function<void(St &)> on_statement;
+  Arena::Mark statement_mark = {};
+  vector<Diagnostic> errors;
+  // Lines of the source parsed into this Env, for showing spans to users.
+  LineTable lines;
+  // If set, every type annotation the parser builds is shared through this
+  // table (see hash_cons.hxx), and a duplicate is released right away.
+  // Record types are left alone, since the same name can resolve to
+  // different records in different places (see resolve.hxx). Not used in
+  // streaming mode. The table must not outlive the arena.
+  HashCons *shared_types = nullptr;
+
+  Env();
+  explicit Env(Interner &interner);
+
+  template <typename T, typename... Args>
+  T *make(Args &&... args) {
+    if constexpr (std::is_base_of_v<PT, T>) stats::count_node<T>();
+    return arena.make<T>(std::forward<Args>(args)...);
+  }
+
+  // Makes a type for the parser, the canonical one if `shared_types` is set.
+  template <typename T, typename... Args>
+  Type *make_type(Span span, Args &&... args) {
+    Arena::Mark mark = arena.mark();
+    T *type = make<T>(std::forward<Args>(args)...);
+    type->span = span;
+    if constexpr (std::is_same_v<T, RecordType>) return type;
+    return shared_types && !on_statement ? share_type(type, mark) : type;
+  }
+  Type *share_type(Type *type, const Arena::Mark &mark);
+
+  void stream_statements(std::function<void(St &)> callback);
+  void flatten_into(FlatTree &tree);
+  void add_statement(vector<St *> &statements, St *st);
+};
+
+// `tag` says which node a PT is, so passes can switch on it instead of
+// adding a virtual method per pass (see visit.hxx). Every concrete node type
+// has its tag as KIND. Expression and statement children are not const, so
+// passes such as fold_constants can replace them in place.
 struct PT {
-  location loc;
+  Span span;
+  NodeKind tag = NodeKind::NONE;
+  // Structural hash of a node made canonical by a HashCons (see
+  // hash_cons.hxx), 0 for any other node. Fits in the padding after `tag`.
+  uint32_t hash = 0;
 
   PT();
+  explicit PT(NodeKind tag);
   virtual ~PT() = default;
 
-  virtual string to_string(Env &env) const = 0;
-  void set_location(location &loc);
+  virtual void print(Printer &p) const = 0;
+  // Convenience for printing into a string; use a Printer on a stream for
+  // large trees.
+  string to_string(Env &env) const;
 };
 
 struct Unit : public PT {
   Unit();
   virtual ~Unit() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
 };
 
 struct InternedValue : public PT {
@@ -69,7 +151,7 @@ struct InternedValue : public PT {
   explicit InternedValue(const InternedValue &);
   virtual ~InternedValue() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
 };
 
 struct AtomValue : public InternedValue {
@@ -103,12 +185,15 @@ struct Value : public PT {
   explicit Value(ValueType val);
   virtual ~Value() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
 };
 
 struct SymbolRef : public PT {
   Id name;
   vector<Id> modules;
+  // The binding this refers to, set by resolve(). Mutable because symbols
+  // are const members of the nodes that hold them.
+  mutable uint32_t target = NO_BINDING;
 
   SymbolRef() = default;
   explicit SymbolRef(Id name);
@@ -119,29 +204,39 @@ struct SymbolRef : public PT {
 
   void shift(Id n);
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
 };
 
 struct Type : public PT {
-  Type();
+  explicit Type(NodeKind tag);
   virtual ~Type() = default;
+
+  virtual NodeId flatten(FlatTree &tree) const = 0;
 };
 
 struct ListType : public Type {
+  static constexpr NodeKind KIND = NodeKind::LIST_TYPE;
+
   ListType();
   virtual ~ListType() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct MapType : public Type {
+  static constexpr NodeKind KIND = NodeKind::MAP_TYPE;
+
   MapType();
   virtual ~MapType() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct RecordType : public Type {
+  static constexpr NodeKind KIND = NodeKind::RECORD_TYPE;
+
   SymbolRef symbol;
   // Type spec will have these fields.
   // const unordered_map<istring, unique_ptr<Type>> fields;
@@ -149,268 +244,339 @@ struct RecordType : public Type {
   explicit RecordType(SymbolRef &symbol);
   virtual ~RecordType() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct AnyType : public Type {
+  static constexpr NodeKind KIND = NodeKind::ANY_TYPE;
+
   AnyType();
   virtual ~AnyType() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct PrimType : public Type {
+  static constexpr NodeKind KIND = NodeKind::PRIM_TYPE;
+
   const enum PrimKind { STRING, INT, FLOAT, BOOL, ATOM, UNIT } kind;
 
   explicit PrimType(PrimKind kind);
   virtual ~PrimType() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct Pat : public PT {
-  unique_ptr<Type> type;
+  Type *type = nullptr;
 
-  Pat();
-  explicit Pat(unique_ptr<Type> &type);
+  explicit Pat(NodeKind tag);
   virtual ~Pat() = default;
 
-  void set_type(unique_ptr<Type> &type);
+  virtual NodeId flatten(FlatTree &tree) const = 0;
+
+  void set_type(Type *type);
  
  protected:
-  string type_string(Env &env) const;
+  void print_type(Printer &p) const;
 };
 
 
+// [a, b, c] or [a, b :: tail]
 struct ListPat : public Pat {
-  // if pat && tail then this is a normal node in the list
-  // if pat && !tail then this is the end of the list
-  // if !pat && tail then this value in tail is supposed to represent a tail pattern
-  // if !pat && !tail then the list is over! Can be used in place of a null tail value
-  const unique_ptr<Pat> pat;
-  const unique_ptr<ListPat> tail;
+  static constexpr NodeKind KIND = NodeKind::LIST_PAT;
 
+  const vector<Pat *> pats;
+  // The pattern after `::`, if any.
+  Pat *const tail = nullptr;
 
   ListPat();
-  explicit ListPat(unique_ptr<Pat> &pat);
-  ListPat(unique_ptr<Pat> &pat, unique_ptr<ListPat> &tail);
-  static unique_ptr<ListPat> make(vector<unique_ptr<Pat>> &pats, unique_ptr<Pat> tail = unique_ptr<Pat>());
+  explicit ListPat(vector<Pat *> &pats, Pat *tail = nullptr);
   virtual ~ListPat() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
-typedef pair<unique_ptr<Pat>, unique_ptr<Pat>> MapPatEntry;
+typedef pair<Pat *, Pat *> MapPatEntry;
 struct MapPat : public Pat {
+  static constexpr NodeKind KIND = NodeKind::MAP_PAT;
+
   const vector<MapPatEntry> entries;
 
   MapPat();
-  explicit MapPat(vector<pair<unique_ptr<Pat>, unique_ptr<Pat>>> &entries);
+  explicit MapPat(vector<pair<Pat *, Pat *>> &entries);
   virtual ~MapPat() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
-typedef pair<AtomValue, unique_ptr<Pat>> RecordPatField;
+typedef pair<AtomValue, Pat *> RecordPatField;
 struct RecordPat : public Pat {
+  static constexpr NodeKind KIND = NodeKind::RECORD_PAT;
+
   SymbolRef record_name;
   const vector<RecordPatField> fields;
+  // Slot of each field in the layout of the record, once lay_out_records()
+  // has run.
+  vector<uint32_t> slots;
 
   explicit RecordPat(SymbolRef& record_name);
   RecordPat(SymbolRef &record_name, vector<RecordPatField> &fields);
   virtual ~RecordPat() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct SymbolPat : public Pat {
+  static constexpr NodeKind KIND = NodeKind::SYMBOL_PAT;
+
   // If this is none it is just a wild card _
   SymbolRef symbol;
 
   explicit SymbolPat(SymbolRef &symbol);
   virtual ~SymbolPat() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct ValuePat : public Pat {
+  static constexpr NodeKind KIND = NodeKind::VALUE_PAT;
+
   Value value;
 
   explicit ValuePat(Value value);
   virtual ~ValuePat() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct Expr : public PT {
-  unique_ptr<Type> type;
+  Type *type = nullptr;
 
-  Expr();
-  explicit Expr(unique_ptr<Type> &type);
+  explicit Expr(NodeKind tag);
   virtual ~Expr() = default;
 
-  void set_type(unique_ptr<Type> &type);
+  virtual NodeId flatten(FlatTree &tree) const = 0;
+
+  void set_type(Type *type);
 };
 
 class St;
 
 // TODO: Make these PT classes
-typedef vector<unique_ptr<St>> Body;
+typedef vector<St *> Body;
 
-string body_to_string(Body &, Env &);
+void print_body(const Body &body, Printer &p);
 
 struct IfElseExpr : public Expr {
-  const unique_ptr<Expr> cond;
-  const Body body;
-  const optional<Body> else_body;
+  static constexpr NodeKind KIND = NodeKind::IF_ELSE_EXPR;
+
+  Expr *cond = nullptr;
+  Body body;
+  optional<Body> else_body;
 
-  IfElseExpr(unique_ptr<Expr> &cond, Body &body);
-  IfElseExpr(unique_ptr<Expr> &cond, Body &body, Body &else_body);
+  IfElseExpr(Expr *cond, Body &body);
+  IfElseExpr(Expr *cond, Body &body, Body &else_body);
   virtual ~IfElseExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
-typedef pair<unique_ptr<Pat>, unique_ptr<Expr>> Case;
+typedef pair<Pat *, Expr *> Case;
 
-string case_to_string(Case &case_, Env &env);
+void print_case(const Case &case_, Printer &p);
 
 struct CaseExpr : public Expr {
-  const unique_ptr<Expr> value;
-  const vector<Case> cases;
+  static constexpr NodeKind KIND = NodeKind::CASE_EXPR;
 
-  CaseExpr(unique_ptr<Expr> &value, vector<Case> &cases);
+  Expr *value = nullptr;
+  vector<Case> cases;
+
+  CaseExpr(Expr *value, vector<Case> &cases);
   virtual ~CaseExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
-typedef pair<AtomValue, unique_ptr<Expr>> RecordExprField;
-string record_expr_field_to_string(RecordExprField &r, Env &env);
+typedef pair<AtomValue, Expr *> RecordExprField;
+void print_record_expr_field(const RecordExprField &r, Printer &p);
 
 struct RecordExpr : public Expr {
+  static constexpr NodeKind KIND = NodeKind::RECORD_EXPR;
+
   const SymbolRef name;
-  const vector<RecordExprField> fields;
+  vector<RecordExprField> fields;
+  // Slot of each field in the layout of the record, once lay_out_records()
+  // has run.
+  vector<uint32_t> slots;
 
   explicit RecordExpr(SymbolRef &name);
   RecordExpr(SymbolRef &name, vector<RecordExprField> &fields);
   virtual ~RecordExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
+// [a, b, c] or [a, b :: tail]
 struct ListExpr : public Expr {
-  const unique_ptr<Expr> value;
-  const unique_ptr<ListExpr> tail;
+  static constexpr NodeKind KIND = NodeKind::LIST_EXPR;
+
+  vector<Expr *> values;
+  // The expression after `::`, if any.
+  Expr *tail = nullptr;
 
   ListExpr();
-  explicit ListExpr(unique_ptr<Expr> &value);
-  ListExpr(unique_ptr<Expr> &value, unique_ptr<ListExpr> &tail);
-  static unique_ptr<ListExpr> make(vector<unique_ptr<Expr>> &values, unique_ptr<Expr> tail = unique_ptr<Expr>());
+  explicit ListExpr(vector<Expr *> &values, Expr *tail = nullptr);
   virtual ~ListExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
   bool is_empty() const;
 };
 
 struct MapExpr : public Expr {
-  const vector<pair<unique_ptr<Expr>, unique_ptr<Expr>>> items;
+  static constexpr NodeKind KIND = NodeKind::MAP_EXPR;
+
+  vector<pair<Expr *, Expr *>> items;
 
   MapExpr();
-  explicit MapExpr(vector<pair<unique_ptr<Expr>, unique_ptr<Expr>>> &items);
+  explicit MapExpr(vector<pair<Expr *, Expr *>> &items);
   virtual ~MapExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 // string, unit, int, float, bool, atom
 struct ValueExpr : public Expr {
+  static constexpr NodeKind KIND = NodeKind::VALUE_EXPR;
+
   const Value value;
 
   ValueExpr();
   explicit ValueExpr(Value value);
   virtual ~ValueExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct SymbolExpr : public Expr {
+  static constexpr NodeKind KIND = NodeKind::SYMBOL_EXPR;
+
   const SymbolRef symbol;
 
   explicit SymbolExpr(SymbolRef &symbol);
   virtual ~SymbolExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct CallExpr : public Expr {
+  static constexpr NodeKind KIND = NodeKind::CALL_EXPR;
+
   const SymbolRef name;
-  const vector<unique_ptr<Expr>> args;
+  vector<Expr *> args;
 
   explicit CallExpr(SymbolRef &name);
-  CallExpr(SymbolRef &name, vector<unique_ptr<Expr>> &args);
+  CallExpr(SymbolRef &name, vector<Expr *> &args);
   virtual ~CallExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 // add sub mul div mod AND OR XOR EQ NEQ lsh rsh, index
 struct BinOpExpr : public Expr {
-  const unique_ptr<Expr> lhs, rhs;
+  static constexpr NodeKind KIND = NodeKind::BIN_OP_EXPR;
+
+  Expr *lhs = nullptr, *rhs = nullptr;
   enum BinOp { ADD, SUB, MUL, DIV, MOD, LAND, LOR, LXOR, BAND, BOR, BXOR, EQ, NEQ, LSH, RSH, INDEX, GT, GTE, LT, LTE } op;
+  // INDEX by an atom on a record whose type is known: the slot of the field.
+  uint32_t slot = NO_SLOT;
 
-  BinOpExpr(unique_ptr<Expr> &lhs, unique_ptr<Expr> &rhs, BinOp op);
+  BinOpExpr(Expr *lhs, Expr *rhs, BinOp op);
   virtual ~BinOpExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 // not, inv
 struct UnOpExpr : public Expr {
-  const unique_ptr<Expr> value;
+  static constexpr NodeKind KIND = NodeKind::UN_OP_EXPR;
+
+  Expr *value = nullptr;
   enum UnOp { NOT, INV, NEG } op;
 
-  UnOpExpr(unique_ptr<Expr> &value, UnOp op);
+  UnOpExpr(Expr *value, UnOp op);
   virtual ~UnOpExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 // List of exprs, introduces a new scope.
 struct CompoundExpr : public Expr {
-  const vector<unique_ptr<Expr>> exprs;
+  static constexpr NodeKind KIND = NodeKind::COMPOUND_EXPR;
+
+  vector<Expr *> exprs;
 
-  explicit CompoundExpr(vector<unique_ptr<Expr>> &exprs);
+  explicit CompoundExpr(vector<Expr *> &exprs);
   virtual ~CompoundExpr() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 // Statements
 struct St : public PT {
-  St() = default;
+  // For def, val, type and module statements, the binding resolve() gave
+  // the name they declare.
+  uint32_t binding = NO_BINDING;
+
+  explicit St(NodeKind tag) : PT(tag) {}
   virtual ~St() = default;
+
+  virtual NodeId flatten(FlatTree &tree) const = 0;
 };
 
 // Defines a functino. Lambdas not supported so this returns type UNIT.
 struct DefSt : public St {
+  static constexpr NodeKind KIND = NodeKind::DEF_ST;
+
   const Id name;
-  const vector<unique_ptr<Pat>> args;
-  const unique_ptr<Type> type;
-  const vector<unique_ptr<St>> body;
+  const vector<Pat *> args;
+  Type *const type = nullptr;
+  vector<St *> body;
 
-  DefSt(Id name, vector<unique_ptr<Pat>> &args, vector<unique_ptr<St>> &body);
-  DefSt(Id name, vector<unique_ptr<Pat>> &args, unique_ptr<Type> &type, vector<unique_ptr<St>> &body);
+  DefSt(Id name, vector<Pat *> &args, vector<St *> &body);
+  DefSt(Id name, vector<Pat *> &args, Type *type, vector<St *> &body);
   virtual ~DefSt() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
-typedef pair<AtomValue, unique_ptr<Type>> RecordEntry;
+typedef pair<AtomValue, Type *> RecordEntry;
 
-string record_entry_to_string(const RecordEntry &entry, Env &env);
+void print_record_entry(const RecordEntry &entry, Printer &p);
 
 struct RecordSt : public St {
+  static constexpr NodeKind KIND = NodeKind::RECORD_ST;
+
   const Id name;
   const vector<RecordEntry> fields;
 
@@ -418,57 +584,73 @@ struct RecordSt : public St {
   RecordSt(Id name, vector<RecordEntry> &fields);
   virtual ~RecordSt() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct ValSt : public St {
+  static constexpr NodeKind KIND = NodeKind::VAL_ST;
+
   const Id name;
-  const unique_ptr<Expr> expr;
+  Expr *expr = nullptr;
 
-  ValSt(Id name, unique_ptr<Expr> &expr);
+  ValSt(Id name, Expr *expr);
   virtual ~ValSt() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 struct ModuleSt : public St {
+  static constexpr NodeKind KIND = NodeKind::MODULE_ST;
+
   Id name;
-  const vector<unique_ptr<St>> statements;
+  vector<St *> statements;
 
-  ModuleSt() = default;
-  explicit ModuleSt(Id name, vector<unique_ptr<St>> &statements);
+  explicit ModuleSt(Id name, vector<St *> &statements);
   virtual ~ModuleSt() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
+
+ protected:
+  explicit ModuleSt(NodeKind tag) : St(tag) {}
 };
 
 struct ExprSt : public St {
-  const unique_ptr<Expr> expr;
+  static constexpr NodeKind KIND = NodeKind::EXPR_ST;
+
+  Expr *expr = nullptr;
 
-  explicit ExprSt(unique_ptr<Expr> &expr);
+  explicit ExprSt(Expr *expr);
   virtual ~ExprSt() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
+  NodeId flatten(FlatTree &tree) const override;
 };
 
 // This should always return UNIT
 struct ForSt : public St {
-  const unique_ptr<Pat> pattern;
-  const unique_ptr<Expr> container;
+  static constexpr NodeKind KIND = NodeKind::FOR_ST;
 
-  ForSt(unique_ptr<Expr> &pattern, unique_ptr<Expr> &container);
+  Pat *const pattern = nullptr;
+  Expr *container = nullptr;
+
+  ForSt(Pat *pattern, Expr *container);
   virtual ~ForSt() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
 };
 
 struct Program : public ModuleSt {
-  vector<unique_ptr<St>> statements;
+  static constexpr NodeKind KIND = NodeKind::PROGRAM;
+
+  vector<St *> statements;
 
-  explicit Program(vector<unique_ptr<St>> &statements);
+  explicit Program(vector<St *> &statements);
   virtual ~Program() = default;
 
-  string to_string(Env &env) const override;
+  void print(Printer &p) const override;
 };
 
 } // namespace dasl::pt
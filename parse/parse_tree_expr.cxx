@@ -1,160 +1,140 @@
 namespace dasl::pt {
 
-Expr::Expr() {}
-Expr::Expr(unique_ptr<Type> &type) : type(move(type)) {}
-
-string body_to_string(const Body &body, Env &env) {
-  string s;
-  env.scope_start();
-  for (auto it = body.begin(); it != body.end(); it++) { s += env.indent() + (*it)->to_string(env) + "\n"; }
-  env.scope_end();
-  return s;
+Expr::Expr(NodeKind tag) : PT(tag) {}
+
+void print_body(const Body &body, Printer &p) {
+  p.scope_start();
+  for (auto it = body.begin(); it != body.end(); it++) {
+    p.indent();
+    (*it)->print(p);
+    p << '\n';
+  }
+  p.scope_end();
 }
 
-void Expr::set_type(unique_ptr<Type> &type) {
-  this->type = move(type);
+void Expr::set_type(Type *type) {
+  this->type = type;
 }
 
-IfElseExpr::IfElseExpr(unique_ptr<Expr> &cond, Body &body) : cond(move(cond)), body(move(body)), else_body(nullopt) {}
-IfElseExpr::IfElseExpr(unique_ptr<Expr> &cond, Body &body, Body &else_body)
-    : cond(move(cond)), body(move(body)), else_body(move(else_body)) {}
+IfElseExpr::IfElseExpr(Expr *cond, Body &body) : Expr(KIND), cond(cond), body(move(body)), else_body(nullopt) {}
+IfElseExpr::IfElseExpr(Expr *cond, Body &body, Body &else_body)
+    : Expr(KIND), cond(cond), body(move(body)), else_body(move(else_body)) {}
 
-string IfElseExpr::to_string(Env &env) const {
-  string s = env.indent() + "if " + cond->to_string(env) + " then\n";
-  s += body_to_string(body, env);
+void IfElseExpr::print(Printer &p) const {
+  p.indent();
+  p << "if ";
+  cond->print(p);
+  p << " then\n";
+  print_body(body, p);
   if (else_body != nullopt) {
-    s += env.indent() + "else\n";
-    s += body_to_string(*else_body, env);
-    s += env.indent() + "end\n";
-  } else {
-    s += env.indent() + "end\n";
+    p.indent();
+    p << "else\n";
+    print_body(*else_body, p);
   }
-  return s;
+  p.indent();
+  p << "end\n";
 }
 
-CaseExpr::CaseExpr(unique_ptr<Expr> &value, vector<Case> &cases) : value(move(value)), cases(move(cases)) {}
+CaseExpr::CaseExpr(Expr *value, vector<Case> &cases) : Expr(KIND), value(value), cases(move(cases)) {}
 
-string case_to_string(const Case &case_, Env &env) {
-  string s = env.indent() + "| " + case_.first->to_string(env) + " => " + case_.second->to_string(env) + "\n";
-  return s;
+void print_case(const Case &case_, Printer &p) {
+  p.indent();
+  p << "| ";
+  case_.first->print(p);
+  p << " => ";
+  case_.second->print(p);
+  p << '\n';
 }
 
-string CaseExpr::to_string(Env &env) const {
-  string s = env.indent() + "case " + value->to_string(env) + " of\n";
-  env.scope_start();
-  for (auto it = cases.cbegin(); it != cases.cend(); it++) { s += case_to_string(*it, env); }
-  env.scope_end();
-  return s;
+void CaseExpr::print(Printer &p) const {
+  p.indent();
+  p << "case ";
+  value->print(p);
+  p << " of\n";
+  p.scope_start();
+  for (auto it = cases.cbegin(); it != cases.cend(); it++) print_case(*it, p);
+  p.scope_end();
 }
 
-string record_expr_field_to_string(const RecordExprField &r, Env &env) {
-  return r.first.to_string(env) + ": " + r.second->to_string(env);
+void print_record_expr_field(const RecordExprField &r, Printer &p) {
+  r.first.print(p);
+  p << ": ";
+  r.second->print(p);
 }
 
-RecordExpr::RecordExpr(SymbolRef &symbol) : name(move(symbol)) {}
-RecordExpr::RecordExpr(SymbolRef &symbol, vector<RecordExprField> &fields) : name(move(symbol)), fields(move(fields)) {}
+RecordExpr::RecordExpr(SymbolRef &symbol) : Expr(KIND), name(move(symbol)) {}
+RecordExpr::RecordExpr(SymbolRef &symbol, vector<RecordExprField> &fields) : Expr(KIND), name(move(symbol)), fields(move(fields)) {}
 
-string RecordExpr::to_string(Env &env) const {
-  string s = name.to_string(env) + " { ";
-  for (auto it = fields.cbegin(); it != fields.cend(); it++) { s += record_expr_field_to_string(*it, env) + ", "; }
-  if (fields.size() != 0) {
-    s.pop_back();
-    s.pop_back();
+void RecordExpr::print(Printer &p) const {
+  name.print(p);
+  p << " { ";
+  for (auto it = fields.cbegin(); it != fields.cend(); it++) {
+    if (it != fields.cbegin()) p << ", ";
+    print_record_expr_field(*it, p);
   }
-  return s + " }";
+  p << " }";
 }
 
-ListExpr::ListExpr() {}
-ListExpr::ListExpr(unique_ptr<Expr> &value) : value(move(value)) {}
-ListExpr::ListExpr(unique_ptr<Expr> &value, unique_ptr<ListExpr> &tail)
-    : value(move(value)), tail(move(tail)) {}
-
-unique_ptr<ListExpr> ListExpr::make(vector<unique_ptr<Expr>> &values, unique_ptr<Expr> tail) {
-  unique_ptr<ListExpr> tail_node = tail ? make_unique<ListExpr>(tail) : unique_ptr<ListExpr>();
-  auto null_expr = unique_ptr<Expr>();
-  unique_ptr<ListExpr> tail_container = make_unique<ListExpr>(null_expr, tail_node);
-  unique_ptr<ListExpr> carry = move(tail_container);
-
-  for (int i = values.size() - 1; i > 0; i--)
-    carry = make_unique<ListExpr>(values[i], carry);
-
-  return make_unique<ListExpr>(values[0], carry);
-}
+ListExpr::ListExpr() : Expr(KIND) {}
+ListExpr::ListExpr(vector<Expr *> &values, Expr *tail) : Expr(KIND), values(move(values)), tail(tail) {}
 
-string ListExpr::to_string(Env &env) const {
-  string s = "[";
-  const ListExpr *i = this;
-  while (i) {
-    if (i->value) {
-      s += i->value->to_string(env) + ", ";
-      i = i->tail.get();
-      if (i == nullptr || i->is_empty()) {
-        s.pop_back();
-        s.pop_back();
-        break;
-      }
-    } else if (i->tail) {
-      s.pop_back();
-      s.pop_back();
-      s += " :: " + i->tail->value->to_string(env);
-      break;
-    } else {
-      break;
-    }
+void ListExpr::print(Printer &p) const {
+  p << '[';
+  for (auto it = values.cbegin(); it != values.cend(); it++) {
+    if (it != values.cbegin()) p << ", ";
+    (*it)->print(p);
   }
-  return s + "]";
+  if (tail) {
+    p << " :: ";
+    tail->print(p);
+  }
+  p << ']';
 }
 
 bool ListExpr::is_empty() const {
-  return !value && !tail;
+  return values.empty() && !tail;
 }
 
-MapExpr::MapExpr() {}
-MapExpr::MapExpr(vector<pair<unique_ptr<Expr>, unique_ptr<Expr>>> &items) : items(move(items)) {}
-
-string MapExpr::to_string(Env &env) const {
-  string s = "{ ";
+MapExpr::MapExpr() : Expr(KIND) {}
+MapExpr::MapExpr(vector<pair<Expr *, Expr *>> &items) : Expr(KIND), items(move(items)) {}
 
-  for (auto it = items.cbegin(); it != items.cend(); it++)
-    s += (*it).first->to_string(env) + " => " + (*it).second->to_string(env) + ", ";
-
-  if (items.size() != 0) {
-    s.pop_back();
-    s.pop_back();
+void MapExpr::print(Printer &p) const {
+  p << "{ ";
+  for (auto it = items.cbegin(); it != items.cend(); it++) {
+    if (it != items.cbegin()) p << ", ";
+    it->first->print(p);
+    p << " => ";
+    it->second->print(p);
   }
-
-  return s + " }";
+  p << " }";
 }
 
-ValueExpr::ValueExpr() : value(Unit{}) {}
-ValueExpr::ValueExpr(Value value) : value(move(value)) {}
+ValueExpr::ValueExpr() : Expr(KIND), value(Unit{}) {}
+ValueExpr::ValueExpr(Value value) : Expr(KIND), value(move(value)) {}
 
-string ValueExpr::to_string(Env &env) const {
-  return value.to_string(env);
-}
+void ValueExpr::print(Printer &p) const { value.print(p); }
 
-SymbolExpr::SymbolExpr(SymbolRef &symbol) : symbol(move(symbol)) {}
+SymbolExpr::SymbolExpr(SymbolRef &symbol) : Expr(KIND), symbol(move(symbol)) {}
 
-string SymbolExpr::to_string(Env &env) const { return symbol.to_string(env); }
+void SymbolExpr::print(Printer &p) const { symbol.print(p); }
 
-CallExpr::CallExpr(SymbolRef &name) : name(move(name)) {}
-CallExpr::CallExpr(SymbolRef &name, vector<unique_ptr<Expr>> &args) : name(move(name)), args(move(args)) {}
+CallExpr::CallExpr(SymbolRef &name) : Expr(KIND), name(move(name)) {}
+CallExpr::CallExpr(SymbolRef &name, vector<Expr *> &args) : Expr(KIND), name(move(name)), args(move(args)) {}
 
-string CallExpr::to_string(Env &env) const {
-  string s = name.to_string(env) + "(";
-  for (auto it = args.cbegin(); it != args.cend(); it++) { s += (*it)->to_string(env) + ", "; }
-  if (args.size() != 0) {
-    s.pop_back();
-    s.pop_back();
+void CallExpr::print(Printer &p) const {
+  name.print(p);
+  p << '(';
+  for (auto it = args.cbegin(); it != args.cend(); it++) {
+    if (it != args.cbegin()) p << ", ";
+    (*it)->print(p);
   }
-  s += ")";
-  return s;
+  p << ')';
 }
 
-BinOpExpr::BinOpExpr(unique_ptr<Expr> &lhs, unique_ptr<Expr> &rhs, BinOp op) : lhs(move(lhs)), rhs(move(rhs)), op(op) {}
+BinOpExpr::BinOpExpr(Expr *lhs, Expr *rhs, BinOp op) : Expr(KIND), lhs(lhs), rhs(rhs), op(op) {}
 
-string BinOpExpr::to_string(Env &env) const {
-  string op_s;
+void BinOpExpr::print(Printer &p) const {
+  const char *op_s = "";
 
   switch (op) {
     case ADD:
@@ -219,41 +199,48 @@ string BinOpExpr::to_string(Env &env) const {
       break;
   }
 
-  if (op == INDEX) return lhs->to_string(env) + "[" + rhs->to_string(env) + "]";
+  if (op == INDEX) {
+    lhs->print(p);
+    p << '[';
+    rhs->print(p);
+    p << ']';
+    return;
+  }
 
-  return "(" + lhs->to_string(env) + " " + op_s + " " + rhs->to_string(env) + ")";
+  p << '(';
+  lhs->print(p);
+  p << ' ' << op_s << ' ';
+  rhs->print(p);
+  p << ')';
 }
 
-UnOpExpr::UnOpExpr(unique_ptr<Expr> &value, UnOp op) : value(move(value)), op(op) {}
+UnOpExpr::UnOpExpr(Expr *value, UnOp op) : Expr(KIND), value(value), op(op) {}
 
-string UnOpExpr::to_string(Env &env) const {
-  string op_s;
+void UnOpExpr::print(Printer &p) const {
+  char op_c = 0;
   switch (op) {
     case NOT:
-      op_s = "!";
+      op_c = '!';
       break;
     case NEG:
-      op_s = "-";
+      op_c = '-';
       break;
     case INV:
-      op_s = "~";
+      op_c = '~';
       break;
   }
 
-  return op_s + value->to_string(env);
+  p << op_c;
+  value->print(p);
 }
 
-CompoundExpr::CompoundExpr(vector<unique_ptr<Expr>> &exprs) : exprs(move(exprs)) {}
+CompoundExpr::CompoundExpr(vector<Expr *> &exprs) : Expr(KIND), exprs(move(exprs)) {}
 
-string CompoundExpr::to_string(Env &env) const {
-  string s;
-
-  for (auto it = exprs.begin(); it != exprs.end(); it++) { s += (*it)->to_string(env) + "; "; }
-
-  s.pop_back();
-  s.pop_back();
-
-  return s;
+void CompoundExpr::print(Printer &p) const {
+  for (auto it = exprs.begin(); it != exprs.end(); it++) {
+    if (it != exprs.begin()) p << "; ";
+    (*it)->print(p);
+  }
 }
 
 } // namespace dasl::pt
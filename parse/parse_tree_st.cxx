@@ -1,89 +1,95 @@
 namespace dasl::pt {
 
-DefSt::DefSt(Id name, vector<unique_ptr<Pat>> &args, vector<unique_ptr<St>> &body)
-    : name(name), args(move(args)), body(move(body)) {}
-DefSt::DefSt(Id name, vector<unique_ptr<Pat>> &args, unique_ptr<Type> &type, vector<unique_ptr<St>> &body)
-    : name(name), args(move(args)), type(move(type)), body(move(body)) {}
-
-string DefSt::to_string(Env &env) const {
-  string s = env.indent() +  "def " + name.to_string(env) + "(";
-
-  if (args.size()) {
-    for (auto it = args.begin(); it != args.end(); it++)
-      s += (*it)->to_string(env) + ", ";
-    s.pop_back(); s.pop_back();
+DefSt::DefSt(Id name, vector<Pat *> &args, vector<St *> &body)
+    : St(KIND), name(name), args(move(args)), body(move(body)) {}
+DefSt::DefSt(Id name, vector<Pat *> &args, Type *type, vector<St *> &body)
+    : St(KIND), name(name), args(move(args)), type(type), body(move(body)) {}
+
+void DefSt::print(Printer &p) const {
+  p.indent();
+  p << "def ";
+  name.print(p);
+  p << '(';
+  for (auto it = args.begin(); it != args.end(); it++) {
+    if (it != args.begin()) p << ", ";
+    (*it)->print(p);
   }
-
-  s += ")";
+  p << ')';
   if (type) {
-    s += " => " + type->to_string(env) + ":\n";
-  } else {
-    s += ":\n";
+    p << " => ";
+    type->print(p);
   }
+  p << ":\n";
 
-  env.scope_start();
-
+  p.scope_start();
   for (auto it = body.begin(); it != body.end(); it++) {
-    s += env.indent() + (*it)->to_string(env) + ";\n";
+    if (it != body.begin()) p << ";\n";
+    p.indent();
+    (*it)->print(p);
   }
-  s.pop_back();
-  s.pop_back();
-  s += "\n";
-
-  env.scope_end();
+  p << '\n';
+  p.scope_end();
 
-  s += env.indent() + "end\n";
-  return s;
+  p.indent();
+  p << "end\n";
 }
 
-string record_entry_to_string(const RecordEntry &entry, Env &env) {
-  return entry.first.to_string(env) + ": " + entry.second->to_string(env);
+void print_record_entry(const RecordEntry &entry, Printer &p) {
+  entry.first.print(p);
+  p << ": ";
+  entry.second->print(p);
 }
 
-RecordSt::RecordSt(Id name) : name(name) {}
-RecordSt::RecordSt(Id name, vector<RecordEntry> &fields) : name(name), fields(move(fields)) {}
+RecordSt::RecordSt(Id name) : St(KIND), name(name) {}
+RecordSt::RecordSt(Id name, vector<RecordEntry> &fields) : St(KIND), name(name), fields(move(fields)) {}
 
-string RecordSt::to_string(Env &env) const {
-  string s = "type " + name.to_string(env) + " = ";
-  if (fields.size()) {
-    s += "{ ";
-
-    for (auto it = fields.begin(); it != fields.end(); it++)
-      s += record_entry_to_string(*it, env) + ", ";
+void RecordSt::print(Printer &p) const {
+  p << "type ";
+  name.print(p);
+  p << " = ";
+  if (fields.empty()) {
+    p << "{}";
+    return;
+  }
 
-    s.pop_back(); s.pop_back();
-    return s + " }";
-  } else {
-    return s + "{}";
+  p << "{ ";
+  for (auto it = fields.begin(); it != fields.end(); it++) {
+    if (it != fields.begin()) p << ", ";
+    print_record_entry(*it, p);
   }
+  p << " }";
 }
 
-ValSt::ValSt(Id name, unique_ptr<Expr> &expr) : name(name), expr(move(expr)) {}
+ValSt::ValSt(Id name, Expr *expr) : St(KIND), name(name), expr(expr) {}
 
-string ValSt::to_string(Env &env) const {
-  return "val " + name.to_string(env) + " = " + expr->to_string(env);
+void ValSt::print(Printer &p) const {
+  p << "val ";
+  name.print(p);
+  p << " = ";
+  expr->print(p);
 }
 
-ModuleSt::ModuleSt(Id name, vector<unique_ptr<St>> &statements) : name(name), statements(move(statements)) {}
+ModuleSt::ModuleSt(Id name, vector<St *> &statements) : St(KIND), name(name), statements(move(statements)) {}
 
-string ModuleSt::to_string(Env &env) const {
-  string s = env.indent() + "module " + name.to_string(env) + "\n";
+void ModuleSt::print(Printer &p) const {
+  p.indent();
+  p << "module ";
+  name.print(p);
+  p << '\n';
 
-  env.scope_start();
-
-  for (auto it = statements.begin(); it != statements.end(); it++)
-    s += env.indent() + (*it)->to_string(env) + "\n";
-
-  env.scope_end();
-
-  s += env.indent() + "end\n";
+  p.scope_start();
+  for (auto it = statements.begin(); it != statements.end(); it++) {
+    p.indent();
+    (*it)->print(p);
+    p << '\n';
+  }
+  p.scope_end();
 
-  return s;
+  p.indent();
+  p << "end\n";
 }
 
-ExprSt::ExprSt(unique_ptr<Expr> &expr) : expr(move(expr)) {}
-string ExprSt::to_string(Env &env) const {
-  return expr->to_string(env);
-}
+ExprSt::ExprSt(Expr *expr) : St(KIND), expr(expr) {}
+void ExprSt::print(Printer &p) const { expr->print(p); }
 
 } // namespace dasl::pt
@@ -1,34 +1,40 @@
 namespace dasl::pt {
 
-Type::Type() {}
+Type::Type(NodeKind tag) : PT(tag) {}
 
-ListType::ListType() {}
-string ListType::to_string(Env &env) const { return "list"; }
+ListType::ListType() : Type(KIND) {}
+void ListType::print(Printer &p) const { p << "list"; }
 
-MapType::MapType() {}
-string MapType::to_string(Env &env) const { return "map"; }
+MapType::MapType() : Type(KIND) {}
+void MapType::print(Printer &p) const { p << "map"; }
 
-RecordType::RecordType(SymbolRef &symbol) : symbol(move(symbol)) {}
-string RecordType::to_string(Env &env) const { return symbol.to_string(env); }
+RecordType::RecordType(SymbolRef &symbol) : Type(KIND), symbol(move(symbol)) {}
+void RecordType::print(Printer &p) const { symbol.print(p); }
 
-AnyType::AnyType() {}
-string AnyType::to_string(Env &env) const { return "any"; }
+AnyType::AnyType() : Type(KIND) {}
+void AnyType::print(Printer &p) const { p << "any"; }
 
-PrimType::PrimType(PrimKind kind) : kind(kind) {}
-string PrimType::to_string(Env &env) const {
+PrimType::PrimType(PrimKind kind) : Type(KIND), kind(kind) {}
+void PrimType::print(Printer &p) const {
   switch (kind) {
     case STRING:
-      return "string";
+      p << "string";
+      break;
     case INT:
-      return "int";
+      p << "int";
+      break;
     case FLOAT:
-      return "float";
+      p << "float";
+      break;
     case BOOL:
-      return "bool";
+      p << "bool";
+      break;
     case ATOM:
-      return "atom";
+      p << "atom";
+      break;
     case UNIT:
-      return "()";
+      p << "()";
+      break;
   }
 }
 
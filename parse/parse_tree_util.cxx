@@ -1,21 +1,45 @@
 namespace dasl::pt {
 
-string Env::indent() {
-  string s;
-  for (int i = 0; i < depth; i++)
-    s += "  ";
-  return s;
+Env::Env() : own_interner(make_unique<Interner>()), interner(*own_interner) {}
+Env::Env(Interner &interner) : interner(interner) {}
+
+void Env::stream_statements(std::function<void(St &)> callback) {
+  on_statement = move(callback);
+  statement_mark = arena.mark();
 }
 
-void Env::scope_start() { depth += 1; }
-void Env::scope_end() { depth -= 1; }
+void Env::flatten_into(FlatTree &tree) {
+  stream_statements([&tree](St &st) { tree.append(st); });
+}
+
+void Env::add_statement(vector<St *> &statements, St *st) {
+  if (!on_statement) {
+    statements.push_back(st);
+    return;
+  }
+
+  // Nothing else lives in the arena past the mark: the parser only holds the
+  // lookahead token at this point.
+  on_statement(*st);
+  arena.release(statement_mark);
+}
+
+Type *Env::share_type(Type *type, const Arena::Mark &mark) {
+  Type *canonical = shared_types->share(type);
+  // Nothing was allocated after `type`, so a duplicate can be rolled back.
+  if (canonical != type) arena.release(mark);
+  return canonical;
+}
 
 SymbolRef::SymbolRef(Id name) : name(name) {}
 SymbolRef::SymbolRef(vector<Id> &modules, Id name) : name(name), modules(move(modules)) {}
 
 SymbolRef &SymbolRef::operator=(SymbolRef&& other) {
+  span = other.span;
   modules = move(other.modules);
   name = other.name;
+  target = other.target;
+  return *this;
 }
 
 void SymbolRef::shift(Id n) {
@@ -23,51 +47,53 @@ void SymbolRef::shift(Id n) {
   name = n;
 }
 
-string SymbolRef::to_string(Env &env) const {
-  string out;
-  for (int i = 0; i < modules.size(); i++) {
-    out += modules[i].to_string(env);
-    out += ".";
+void SymbolRef::print(Printer &p) const {
+  for (auto it = modules.begin(); it != modules.end(); it++) {
+    it->print(p);
+    p << '.';
   }
-  out += name.to_string(env);
-  return out;
+  name.print(p);
 }
 
 InternedValue::InternedValue() : val(istring { ~0UL }) {}
 InternedValue::InternedValue(istring val) : val(val) {}
-InternedValue::InternedValue(const InternedValue &iv) : val(iv.val) {}
+InternedValue::InternedValue(const InternedValue &iv) : PT(iv), val(iv.val) {}
 
-string InternedValue::to_string(Env &env) const {
-  return env.interner.get_string(val);
-}
+void InternedValue::print(Printer &p) const { p << val; }
 
 StringValue::StringValue(istring str) : InternedValue(str) {}
 StringValue::StringValue(const InternedValue &iv) : InternedValue(iv.val) {}
 
 AtomValue::AtomValue(istring atom) : InternedValue(atom) {}
-AtomValue::AtomValue(const InternedValue &iv) : InternedValue(iv.val) {}
+AtomValue::AtomValue(const InternedValue &iv) : InternedValue(iv) {}
 
 Id::Id(istring id) : InternedValue(id) {}
-Id::Id(const InternedValue &iv) : InternedValue(iv.val) {}
+Id::Id(const InternedValue &iv) : InternedValue(iv) {}
 
 Unit::Unit() {}
-string Unit::to_string(Env &env) const { return "{}"; }
+void Unit::print(Printer &p) const { p << "{}"; }
 
 Value::Value(ValueType value) : value(value), kind(static_cast<ValueKind>(this->value.index())) {}
-string Value::to_string(Env &env) const {
+void Value::print(Printer &p) const {
   switch (kind) {
     case STRING:
-      return "\"" + std::get<STRING>(value).to_string(env) + "\"";
+      p << '"' << std::get<STRING>(value).val << '"';
+      break;
     case UNIT:
-      return "()";
+      p << "()";
+      break;
     case INT:
-      return std::to_string(std::get<INT>(value));
+      p << static_cast<uint64_t>(std::get<INT>(value));
+      break;
     case FLOAT:
-      return std::to_string(std::get<FLOAT>(value));
+      p << std::get<FLOAT>(value);
+      break;
     case BOOL:
-      return std::to_string(std::get<BOOL>(value));
+      p << (std::get<BOOL>(value) ? '1' : '0');
+      break;
     case ATOM:
-      return ":" + std::get<ATOM>(value).to_string(env);
+      p << ':' << std::get<ATOM>(value).val;
+      break;
     default:
       // Unreachable
       exit(1);
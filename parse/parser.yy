@@ -16,7 +16,7 @@
     #include <memory>
     using namespace std;
 
-    #include <location.hh>
+    #include "source_map.hxx"
 
     #include <parse_tree.hxx>
     using namespace dasl;
@@ -56,6 +56,7 @@
 %parse-param { dasl::Lexer &lexer }
 %parse-param { dasl::pt::Env &env }
 %locations
+%define api.location.type { dasl::Span }
 %define parse.trace
 %define parse.error verbose
 
@@ -64,11 +65,11 @@
 %token END 0 "end of file"
 
 // values
-%token <std::string> STRING  "string";
-%token <std::string> ATOM    "atom"
+%token <istring> STRING  "string";
+%token <istring> ATOM    "atom"
 %token <uint64_t> INT "int";
 %token <double> FLOAT "float";
-%token <std::string> ID "id";
+%token <istring> ID "id";
 
 
 // Symbols
@@ -80,6 +81,7 @@
 %token COMMA      ",";
 %token TAIL       "::";
 %token COLON      ":";
+%token BAR        "|";
 %token SQ_BOPEN   "["
 %token SQ_BCLOSE  "]"
 %token DOT        "."
@@ -134,65 +136,65 @@
 %token EOF        "eof";
 
 %type< int > program;
-%type< vector<unique_ptr<St>> > stmt_list;
+%type< vector<St *> > stmt_list;
 %type< SymbolRef > symbol;
-%type< unique_ptr<Type> > type;
-%type< unique_ptr<Pat> > pat;
-%type< unique_ptr<Pat> > typed_pat;
-%type< unique_ptr<Pat> > list_pat;
-%type< unique_ptr<Pat> > value_pat;
-%type< unique_ptr<Pat> > map_pat;
-%type< unique_ptr<Pat> > record_pat;
-%type< unique_ptr<Pat> > symbol_pat;
-%type< vector<unique_ptr<Pat>> > pat_list;
+%type< Type * > type;
+%type< Pat * > pat;
+%type< Pat * > typed_pat;
+%type< Pat * > list_pat;
+%type< Pat * > value_pat;
+%type< Pat * > map_pat;
+%type< Pat * > record_pat;
+%type< Pat * > symbol_pat;
+%type< vector<Pat *> > pat_list;
 %type< MapPatEntry > map_pat_entry;
 %type< vector<MapPatEntry> > map_pat_entry_list;
 %type< RecordPatField > record_pat_field;
 %type< vector<RecordPatField> > record_pat_field_list;
 %type< Id > id;
-%type< unique_ptr<Expr> > primary_expr;
-%type< unique_ptr<Expr> > postfix_expr;
-%type< unique_ptr<Expr> > unary_expr;
-%type< unique_ptr<Expr> > mult_expr;
-%type< unique_ptr<Expr> > add_expr;
-%type< unique_ptr<Expr> > shift_expr;
-%type< unique_ptr<Expr> > comp_expr;
-%type< unique_ptr<Expr> > eq_expr;
-%type< unique_ptr<Expr> > band_expr;
-%type< unique_ptr<Expr> > bxor_expr;
-%type< unique_ptr<Expr> > bor_expr;
-%type< unique_ptr<Expr> > land_expr;
-%type< unique_ptr<Expr> > lxor_expr;
-%type< unique_ptr<Expr> > lor_expr;
-// %type< vector<unique_ptr<Expr>> > expr_inner;
-%type< unique_ptr<Expr> > expr;
-%type< unique_ptr<Expr> > if_expr;
-%type< unique_ptr<Expr> > list_expr;
-%type< vector<unique_ptr<Expr>> > expr_list;
-%type< vector<unique_ptr<Expr>> > call_args;
+%type< Expr * > primary_expr;
+%type< Expr * > postfix_expr;
+%type< Expr * > unary_expr;
+%type< Expr * > mult_expr;
+%type< Expr * > add_expr;
+%type< Expr * > shift_expr;
+%type< Expr * > comp_expr;
+%type< Expr * > eq_expr;
+%type< Expr * > band_expr;
+%type< Expr * > bxor_expr;
+%type< Expr * > bor_expr;
+%type< Expr * > land_expr;
+%type< Expr * > lxor_expr;
+%type< Expr * > lor_expr;
+// %type< vector<Expr *> > expr_inner;
+%type< Expr * > expr;
+%type< Expr * > if_expr;
+%type< Expr * > list_expr;
+%type< vector<Expr *> > expr_list;
+%type< vector<Expr *> > call_args;
 %type< RecordExprField > record_expr_field;
 %type< vector<RecordExprField> > record_expr_field_list;
-%type< unique_ptr<Expr> > record_expr;
-%type< unique_ptr<St> > expr_stmt;
-%type< unique_ptr<St> > stmt;
-%type< unique_ptr<St> > def_stmt;
-%type< unique_ptr<St> > val_stmt;
-%type< unique_ptr<St> > record_stmt;
-%type< unique_ptr<St> > module_stmt;
-%type< vector<unique_ptr<St>> > body;
-%type< vector<unique_ptr<St>> > module_body;
+%type< Expr * > record_expr;
+%type< St * > expr_stmt;
+%type< St * > stmt;
+%type< St * > def_stmt;
+%type< St * > val_stmt;
+%type< St * > record_stmt;
+%type< St * > module_stmt;
+%type< vector<St *> > body;
+%type< vector<St *> > module_body;
 %type< vector<RecordEntry> > record_entry_list;
 %type< RecordEntry > record_entry;
-%type< vector<unique_ptr<Pat>> > def_arg_list;
-%type< vector<unique_ptr<Pat>> > def_args;
+%type< vector<Pat *> > def_arg_list;
+%type< vector<Pat *> > def_args;
 %type< AtomValue > atom;
 
 %type< Case > case_;
 %type< vector<Case> > cases;
-%type< unique_ptr<Expr> > case_expr;
+%type< Expr * > case_expr;
 
-%type< vector<unique_ptr<Expr>> > argument_expr_list;
-%type< vector<unique_ptr<Expr>> > compound_expr;
+%type< vector<Expr *> > argument_expr_list;
+%type< vector<Expr *> > compound_expr;
 %type< UnOpExpr::UnOp > un_op;
 %type< BinOpExpr::BinOp > mult_op;
 %type< BinOpExpr::BinOp > add_op;
@@ -205,51 +207,51 @@
 %%
 
 id 
-  : ID { $$ = Id(env.interner.get($1)); }
+  : ID { $$ = Id($1); $$.span = @$; }
   ;
 
 atom 
-  : ATOM { string x {$1, 1}; $$ = AtomValue(env.interner.get(x)); }
+  : ATOM { $$ = AtomValue($1); $$.span = @$; }
   ;
 
 symbol 
-  : id            { $$ = SymbolRef($1); }
-  | symbol DOT id { $1.shift($3); $$ = move($1); }
+  : id            { $$ = SymbolRef($1); $$.span = @$; }
+  | symbol DOT id { $1.shift($3); $$ = move($1); $$.span = @$; }
   ;
 
 type 
-  : KW_LIST { $$ = make_unique<ListType>(); }
-  | KW_MAP  { $$ = make_unique<MapType>();  }
-  | symbol { $$ = make_unique<RecordType>($1); }
-  | KW_ANY { $$ = make_unique<AnyType>(); }
-  | KW_STRING { $$ = make_unique<PrimType>(PrimType::STRING); }
-  | KW_INT { $$ = make_unique<PrimType>(PrimType::INT); }
-  | KW_FLOAT { $$ = make_unique<PrimType>(PrimType::FLOAT); }
-  | KW_BOOL { $$ = make_unique<PrimType>(PrimType::BOOL); }
-  | KW_ATOM { $$ = make_unique<PrimType>(PrimType::ATOM); }
-  | POPEN PCLOSE { $$ = make_unique<PrimType>(PrimType::UNIT); }
+  : KW_LIST { $$ = env.make_type<ListType>(@$); }
+  | KW_MAP  { $$ = env.make_type<MapType>(@$); }
+  | symbol { $$ = env.make_type<RecordType>(@$, $1); }
+  | KW_ANY { $$ = env.make_type<AnyType>(@$); }
+  | KW_STRING { $$ = env.make_type<PrimType>(@$, PrimType::STRING); }
+  | KW_INT { $$ = env.make_type<PrimType>(@$, PrimType::INT); }
+  | KW_FLOAT { $$ = env.make_type<PrimType>(@$, PrimType::FLOAT); }
+  | KW_BOOL { $$ = env.make_type<PrimType>(@$, PrimType::BOOL); }
+  | KW_ATOM { $$ = env.make_type<PrimType>(@$, PrimType::ATOM); }
+  | POPEN PCLOSE { $$ = env.make_type<PrimType>(@$, PrimType::UNIT); }
   ;
 
 pat_list 
-  : typed_pat { vector<unique_ptr<Pat>> v; v.push_back(move($1)); $$ = move(v); }
+  : typed_pat { vector<Pat *> v; v.push_back(move($1)); $$ = move(v); }
   | pat_list COMMA typed_pat { $1.push_back(move($3)); $$ = move($1); }
   ;
 
 list_pat 
-  : "[" "]" { $$ = make_unique<ListPat>(); } 
-  | "[" pat_list "]" { $$ = ListPat::make($2); }
-  | "[" pat_list "::" typed_pat "]" { $$ = ListPat::make($2, move($4)); }
+  : "[" "]" { $$ = env.make<ListPat>(); $$->span = @$; } 
+  | "[" pat_list "]" { $$ = env.make<ListPat>($2); $$->span = @$; }
+  | "[" pat_list "::" typed_pat "]" { $$ = env.make<ListPat>($2, $4); $$->span = @$; }
   ;
 
 expr_list
-  : expr { vector<unique_ptr<Expr>> e; e.push_back(move($1)); $$ = move(e); }
+  : expr { vector<Expr *> e; e.push_back(move($1)); $$ = move(e); }
   | expr_list COMMA expr { $1.push_back(move($3)); $$ = move($1); }
   ;
 
 list_expr
-  : "[" "]" { $$ = make_unique<ListExpr>(); }
-  | "[" expr_list "]" { $$ = ListExpr::make($2); }
-  | "[" expr_list "::" expr "]" { $$ = ListExpr::make($2, move($4)); }
+  : "[" "]" { $$ = env.make<ListExpr>(); $$->span = @$; }
+  | "[" expr_list "]" { $$ = env.make<ListExpr>($2); $$->span = @$; }
+  | "[" expr_list "::" expr "]" { $$ = env.make<ListExpr>($2, $4); $$->span = @$; }
   ;
 
 map_pat_entry 
@@ -258,41 +260,41 @@ map_pat_entry
   ;
 
 map_pat_entry_list 
-  : map_pat_entry { vector<pair<unique_ptr<Pat>, unique_ptr<Pat>>> x; x.push_back(move($1)); $$ = move(x); }
+  : map_pat_entry { vector<pair<Pat *, Pat *>> x; x.push_back(move($1)); $$ = move(x); }
   | map_pat_entry_list COMMA map_pat_entry { $1.push_back(move($3)); $$ = move($1); }
   ;
 
 map_pat 
-  : CBOPEN CBCLOSE { $$ = make_unique<MapPat>(); }
-  | CBOPEN map_pat_entry_list CBCLOSE { $$ = make_unique<MapPat>($2); }
+  : CBOPEN CBCLOSE { $$ = env.make<MapPat>(); $$->span = @$; }
+  | CBOPEN map_pat_entry_list CBCLOSE { $$ = env.make<MapPat>($2); $$->span = @$; }
   ;
 
 record_pat_field 
-  : id COLON pat { $$ = make_pair(AtomValue($1.val), move($3)); }
+  : id COLON pat { $$ = make_pair(AtomValue($1), move($3)); }
   ;
 
 record_pat_field_list
-  : record_pat_field { vector<pair<AtomValue, unique_ptr<Pat>>> x; x.push_back(move($1)); $$ = move(x); }
+  : record_pat_field { vector<pair<AtomValue, Pat *>> x; x.push_back(move($1)); $$ = move(x); }
   | record_pat_field_list COMMA record_pat_field { $1.push_back(move($3)); $$ = move($1); }
   ;
 
 record_pat
-  : symbol CBOPEN CBCLOSE { $$ = make_unique<RecordPat>($1); }
-  | symbol CBOPEN record_pat_field_list CBCLOSE { $$ = make_unique<RecordPat>($1, $3); }
+  : symbol CBOPEN CBCLOSE { $$ = env.make<RecordPat>($1); $$->span = @$; }
+  | symbol CBOPEN record_pat_field_list CBCLOSE { $$ = env.make<RecordPat>($1, $3); $$->span = @$; }
   ;
 
 symbol_pat 
-  : symbol { $$ = make_unique<SymbolPat>($1); }
+  : symbol { $$ = env.make<SymbolPat>($1); $$->span = @$; }
   ;
 
 value_pat
-  : INT { $$ = make_unique<ValuePat>(Value($1)); }
-  | "(" ")" { $$ = make_unique<ValuePat>(Value(Unit())); }
-  | STRING { $$ = make_unique<ValuePat>(Value(StringValue(env.interner.get($1)))); }
-  | FLOAT { $$ = make_unique<ValuePat>(Value($1)); }
-  | "true" { $$ = make_unique<ValuePat>(Value(true)); }
-  | "false" { $$ = make_unique<ValuePat>(Value(false)); }
-  | atom { $$ = make_unique<ValuePat>(Value($1)); }
+  : INT { $$ = env.make<ValuePat>(Value($1)); $$->span = @$; }
+  | "(" ")" { $$ = env.make<ValuePat>(Value(Unit())); $$->span = @$; }
+  | STRING { $$ = env.make<ValuePat>(Value(StringValue($1))); $$->span = @$; }
+  | FLOAT { $$ = env.make<ValuePat>(Value($1)); $$->span = @$; }
+  | "true" { $$ = env.make<ValuePat>(Value(true)); $$->span = @$; }
+  | "false" { $$ = env.make<ValuePat>(Value(false)); $$->span = @$; }
+  | atom { $$ = env.make<ValuePat>(Value($1)); $$->span = @$; }
   ;
 
 pat
@@ -310,28 +312,28 @@ typed_pat
 
 def_arg_list
   : def_arg_list "," typed_pat { $1.push_back(move($3)); $$ = move($1); }
-  | typed_pat { vector<unique_ptr<Pat>> v; v.push_back(move($1)); $$ = move(v); }
+  | typed_pat { vector<Pat *> v; v.push_back(move($1)); $$ = move(v); }
   ;
 
 def_args
-  : "(" ")" { vector<unique_ptr<Pat>> v; $$ = move(v); }
+  : "(" ")" { vector<Pat *> v; $$ = move(v); }
   | "(" def_arg_list ")" { $$ = move($2); }
   ;
 
 body
   // : body stmt { $1.push_back(move($2)); $$ = move($1); }
   : body ";" stmt { $1.push_back(move($3)); $$ = move($1); }
-  | stmt { vector<unique_ptr<St>> x; x.push_back(move($1)); $$ = move(x); }
+  | stmt { vector<St *> x; x.push_back(move($1)); $$ = move(x); }
   ;
 
 def_stmt
-  : "def" id def_args "do" body "end" { $$ = make_unique<DefSt>($2, $3, $5); }
-  | "def" id def_args "arrow" type "do" body "end" { $$ = make_unique<DefSt>($2, $3, $5, $7); }
+  : "def" id def_args "do" body "end" { $$ = env.make<DefSt>($2, $3, $5); $$->span = @$; }
+  | "def" id def_args "arrow" type "do" body "end" { $$ = env.make<DefSt>($2, $3, $5, $7); $$->span = @$; }
   ;
 
 record_entry
   : atom ARROW type { $$ = make_pair($1, move($3)); }
-  | id COLON type { $$ = make_pair(AtomValue($1.val), move($3)); }
+  | id COLON type { $$ = make_pair(AtomValue($1), move($3)); }
   ;
 
 record_entry_list
@@ -340,26 +342,26 @@ record_entry_list
   ;
 
 record_stmt
-  : "type" id ASSIGN CBOPEN CBCLOSE { $$ = make_unique<RecordSt>($2); }
-  | "type" id ASSIGN CBOPEN record_entry_list CBCLOSE { $$ = make_unique<RecordSt>($2, $5); }
+  : "type" id ASSIGN CBOPEN CBCLOSE { $$ = env.make<RecordSt>($2); $$->span = @$; }
+  | "type" id ASSIGN CBOPEN record_entry_list CBCLOSE { $$ = env.make<RecordSt>($2, $5); $$->span = @$; }
   ;
 
 val_stmt
-  : "val" id "=" expr { $$ = make_unique<ValSt>($2, $4); }
+  : "val" id "=" expr { $$ = env.make<ValSt>($2, $4); $$->span = @$; }
   ;
 
 module_body
   : module_body stmt { $1.push_back(move($2)); $$ = move($1); }
   | module_body ";" stmt { $1.push_back(move($3)); $$ = move($1); }
-  | stmt { vector<unique_ptr<St>> v; v.push_back(move($1)); $$ = move(v); }
+  | stmt { vector<St *> v; v.push_back(move($1)); $$ = move(v); }
   ;
 
 module_stmt
-  : "module" id module_body "end" { $$ = make_unique<ModuleSt>($2, $3); }
+  : "module" id module_body "end" { $$ = env.make<ModuleSt>($2, $3); $$->span = @$; }
   ;
 
 expr_stmt
-  : expr { $$ = make_unique<ExprSt>($1); }
+  : expr { $$ = env.make<ExprSt>($1); $$->span = @$; }
   ;
 
 stmt
@@ -377,46 +379,46 @@ record_expr_field
 
 record_expr_field_list
   : record_expr_field_list "," record_expr_field { $1.push_back(move($3)); $$ = move($1); }
-  | record_expr_field { vector<pair<AtomValue, unique_ptr<Expr>>> v; v.push_back(move($1)); $$ = move(v); }
+  | record_expr_field { vector<pair<AtomValue, Expr *>> v; v.push_back(move($1)); $$ = move(v); }
   ;
 
 record_expr
-  : symbol CBOPEN record_expr_field_list CBCLOSE { $$ = make_unique<RecordExpr>($1, $3); }
-  | symbol CBOPEN CBCLOSE { $$ = make_unique<RecordExpr>($1); }
+  : symbol CBOPEN record_expr_field_list CBCLOSE { $$ = env.make<RecordExpr>($1, $3); $$->span = @$; }
+  | symbol CBOPEN CBCLOSE { $$ = env.make<RecordExpr>($1); $$->span = @$; }
   ;
 
 // compound_expr
 //   : compound_expr ";" expr { $1.push_back(move($3)); $$ = move($1); }
-//   | expr { vector<unique_ptr<Expr>> e; e.push_back(move($1)); $$ = move(e); }
+//   | expr { vector<Expr *> e; e.push_back(move($1)); $$ = move(e); }
 //   ;
 
 primary_expr 
-  : STRING { $$ = make_unique<ValueExpr>(Value(StringValue(env.interner.get($1)))); }
-  | atom { $$ = make_unique<ValueExpr>(Value($1)); }
+  : STRING { $$ = env.make<ValueExpr>(Value(StringValue($1))); $$->span = @$; }
+  | atom { $$ = env.make<ValueExpr>(Value($1)); $$->span = @$; }
   | record_expr { $$ = move($1); }
-  | symbol { $$ = make_unique<SymbolExpr>($1); }
-  | INT { $$ = make_unique<ValueExpr>(Value($1)); }
-  | FLOAT { $$ = make_unique<ValueExpr>(Value($1)); }
-  | POPEN PCLOSE { $$ = make_unique<ValueExpr>(Value(Unit())); }
-  | KW_FALSE { $$ = make_unique<ValueExpr>(Value(false)); }
-  | KW_TRUE { $$ = make_unique<ValueExpr>(Value(true)); }
+  | symbol { $$ = env.make<SymbolExpr>($1); $$->span = @$; }
+  | INT { $$ = env.make<ValueExpr>(Value($1)); $$->span = @$; }
+  | FLOAT { $$ = env.make<ValueExpr>(Value($1)); $$->span = @$; }
+  | POPEN PCLOSE { $$ = env.make<ValueExpr>(Value(Unit())); $$->span = @$; }
+  | KW_FALSE { $$ = env.make<ValueExpr>(Value(false)); $$->span = @$; }
+  | KW_TRUE { $$ = env.make<ValueExpr>(Value(true)); $$->span = @$; }
   | POPEN expr PCLOSE { $$ = move($2); }
   | list_expr { $$ = move($1); }
   ;
 
 postfix_expr
   : primary_expr { $$ = move($1); }
-  | postfix_expr "[" expr "]" { $$ = make_unique<BinOpExpr>($1, $3, BinOpExpr::INDEX); }
-  | symbol call_args { $$ = make_unique<CallExpr>($1, $2); }
+  | postfix_expr "[" expr "]" { $$ = env.make<BinOpExpr>($1, $3, BinOpExpr::INDEX); $$->span = @$; }
+  | symbol call_args { $$ = env.make<CallExpr>($1, $2); $$->span = @$; }
   ;
 
 call_args
-  : "(" ")" { $$ = vector<unique_ptr<Expr>>(); }
+  : "(" ")" { $$ = vector<Expr *>(); }
   | "(" argument_expr_list ")" { $$ = move($2); }
   ;
 
 argument_expr_list
-  : expr { vector<unique_ptr<Expr>> args; args.push_back(move($1)); $$ = move(args); }
+  : expr { vector<Expr *> args; args.push_back(move($1)); $$ = move(args); }
   | argument_expr_list COMMA expr { $1.push_back(move($3)); $$ = move($1); }
   ;
 
@@ -427,7 +429,7 @@ un_op
   ;
 
 unary_expr
-  : un_op postfix_expr { $$ = make_unique<UnOpExpr>($2, $1); }
+  : un_op postfix_expr { $$ = env.make<UnOpExpr>($2, $1); $$->span = @$; }
   | postfix_expr { $$ = move($1); }
   ;
 
@@ -438,7 +440,7 @@ mult_op
   ;
 
 mult_expr
-  : mult_expr mult_op unary_expr { $$ = make_unique<BinOpExpr>($1, $3, $2); }
+  : mult_expr mult_op unary_expr { $$ = env.make<BinOpExpr>($1, $3, $2); $$->span = @$; }
   | unary_expr { $$ = move($1); }
   ;
 
@@ -448,7 +450,7 @@ add_op
   ;
 
 add_expr
-  : add_expr add_op mult_expr { $$ = make_unique<BinOpExpr>($1, $3, $2); }
+  : add_expr add_op mult_expr { $$ = env.make<BinOpExpr>($1, $3, $2); $$->span = @$; }
   | mult_expr { $$ = move($1); }
   ;
 
@@ -458,7 +460,7 @@ shift_op
   ;
 
 shift_expr
-  : shift_expr shift_op add_expr { $$ = make_unique<BinOpExpr>($1, $3, $2); }
+  : shift_expr shift_op add_expr { $$ = env.make<BinOpExpr>($1, $3, $2); $$->span = @$; }
   | add_expr { $$ = move($1); }
   ;
 
@@ -470,7 +472,7 @@ comp_op
   ;
 
 comp_expr
-  : comp_expr comp_op shift_expr { $$ = make_unique<BinOpExpr>($1, $3, $2); }
+  : comp_expr comp_op shift_expr { $$ = env.make<BinOpExpr>($1, $3, $2); $$->span = @$; }
   | shift_expr { $$ = move($1); }
   ;
 
@@ -480,49 +482,49 @@ eq_op
   ;
 
 eq_expr
-  : eq_expr eq_op comp_expr { $$ = make_unique<BinOpExpr>($1, $3, $2); }
+  : eq_expr eq_op comp_expr { $$ = env.make<BinOpExpr>($1, $3, $2); $$->span = @$; }
   | comp_expr { $$ = move($1); }
   ;
 
 band_expr
-  : band_expr BAND eq_expr { $$ = make_unique<BinOpExpr>($1, $3, BinOpExpr::BAND); }
+  : band_expr BAND eq_expr { $$ = env.make<BinOpExpr>($1, $3, BinOpExpr::BAND); $$->span = @$; }
   | eq_expr { $$ = move($1); }
   ;
 
 bxor_expr
-  : bxor_expr BXOR band_expr { $$ = make_unique<BinOpExpr>($1, $3, BinOpExpr::BXOR); }
+  : bxor_expr BXOR band_expr { $$ = env.make<BinOpExpr>($1, $3, BinOpExpr::BXOR); $$->span = @$; }
   | band_expr { $$ = move($1); }
   ;
 
 bor_expr
-  : bor_expr BOR bxor_expr { $$ = make_unique<BinOpExpr>($1, $3, BinOpExpr::BOR); }
+  : bor_expr BOR bxor_expr { $$ = env.make<BinOpExpr>($1, $3, BinOpExpr::BOR); $$->span = @$; }
   | bxor_expr { $$ = move($1); }
   ;
 
 land_expr
-  : land_expr LAND bor_expr { $$ = make_unique<BinOpExpr>($1, $3, BinOpExpr::LAND); }
+  : land_expr LAND bor_expr { $$ = env.make<BinOpExpr>($1, $3, BinOpExpr::LAND); $$->span = @$; }
   | bor_expr { $$ = move($1); }
   ;
 
 lxor_expr
-  : lxor_expr LXOR land_expr { $$ = make_unique<BinOpExpr>($1, $3, BinOpExpr::LXOR); }
+  : lxor_expr LXOR land_expr { $$ = env.make<BinOpExpr>($1, $3, BinOpExpr::LXOR); $$->span = @$; }
   | land_expr { $$ = move($1); }
   ;
 
 lor_expr
-  : lor_expr LOR lxor_expr { $$ = make_unique<BinOpExpr>($1, $3, BinOpExpr::LOR); }
+  : lor_expr LOR lxor_expr { $$ = env.make<BinOpExpr>($1, $3, BinOpExpr::LOR); $$->span = @$; }
   | lxor_expr { $$ = move($1); }
   ;
 
 // expr_inner
 //   : expr_inner SEMICOLON lor_expr { $1.push_back(move($3)); $$ = move($1); }
 //   | expr_inner lor_expr { $1.push_back(move($2)); $$ = move($1); }
-//   | lor_expr { vector<unique_ptr<Expr>> e; e.push_back(move($1)); $$ = move(e); }
+//   | lor_expr { vector<Expr *> e; e.push_back(move($1)); $$ = move(e); }
 //   ;
 
 if_expr 
-  : "if" expr "then" body "end" { $$ = make_unique<IfElseExpr>($2, $4); }
-  | "if" expr "then" body "else" body "end" { $$ = make_unique<IfElseExpr>($2, $4, $6); }
+  : "if" expr "then" body "end" { $$ = env.make<IfElseExpr>($2, $4); $$->span = @$; }
+  | "if" expr "then" body "else" body "end" { $$ = env.make<IfElseExpr>($2, $4, $6); $$->span = @$; }
   ;
 
 case_ 
@@ -536,7 +538,7 @@ cases
   ;
 
 case_expr
-  : "case" expr "of" cases { $$ = make_unique<CaseExpr>($2, $4); }
+  : "case" expr "of" cases { $$ = env.make<CaseExpr>($2, $4); $$->span = @$; }
   ;
 expr
   : lor_expr { $$ = move($1); }
@@ -545,22 +547,20 @@ expr
   ;
 
 stmt_list
-  : stmt_list stmt { $1.push_back(move($2)); $$ = move($1); }
-  | stmt { vector<unique_ptr<St>> s; s.push_back(move($1)); $$ = move(s); }
+  : stmt_list stmt { env.add_statement($1, $2); $$ = move($1); }
+  | stmt { vector<St *> s; env.add_statement(s, $1); $$ = move(s); }
   ;
 
 program
-  : stmt_list END { env.pt = make_unique<Program>($1); $$ = 0; }
+  : stmt_list END { env.pt = env.make<Program>($1); $$ = 0; }
   ;
 
 %%
 
 // Bison expects us to provide implementation - otherwise linker complains
-void dasl::Parser::error(const location &loc , const std::string &message) {
+void dasl::Parser::error(const location_type &span, const std::string &message) {
         
-        // Location should be initialized inside lexer action, but is not in this example.
-        // Let's grab location directly from driver class.
-	// cout << "Error: " << message << endl << "Location: " << loc << endl;
-	
-        cout << "Error: " << message << endl << "Error location: " << loc.begin.line << ":" << loc.begin.column << endl;
+        // Errors are collected rather than printed so that drivers parsing many
+        // files at once can report them per file.
+        env.errors.push_back({ span, message });
 }
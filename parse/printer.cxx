@@ -0,0 +1,41 @@
+#include "printer.hxx"
+
+#include <charconv>
+#include <cstdio>
+
+namespace dasl::pt {
+
+Printer::Printer(std::ostream &out) : out(&out) { buffer.reserve(FLUSH_SIZE); }
+
+Printer::Printer(const Interner &interner) : interner(&interner) {}
+
+Printer::Printer(const Interner &interner, std::ostream &out) : Printer(out) { this->interner = &interner; }
+
+Printer::~Printer() { flush(); }
+
+Printer &Printer::operator<<(uint64_t n) {
+  char digits[20];
+  auto res = std::to_chars(digits, digits + sizeof digits, n);
+  return *this << string_view(digits, res.ptr - digits);
+}
+
+// Same format as std::to_string(double), without the temporary string.
+Printer &Printer::operator<<(double f) {
+  char digits[512];
+  int n = std::snprintf(digits, sizeof digits, "%f", f);
+  return *this << string_view(digits, n);
+}
+
+void Printer::scope_start() {
+  depth++;
+  if (indent_str.size() < depth * 2) indent_str.append("  ");
+}
+
+void Printer::flush() {
+  if (!out) return;
+  out->write(buffer.data(), buffer.size());
+  out->flush();
+  buffer.clear();
+}
+
+} // namespace dasl::pt
@@ -0,0 +1,74 @@
+#ifndef PRINTER_HXX
+#define PRINTER_HXX
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+using std::string;
+#include <string_view>
+using std::string_view;
+
+#include "interner.hxx"
+
+namespace dasl::pt {
+
+// Sink for the pretty printer. Nodes append to one buffer that is reused for
+// the whole tree instead of returning strings for their parents to
+// concatenate, so printing is linear in the size of the output. With a stream
+// attached the buffer is written out whenever it fills up, which keeps memory
+// flat no matter how large the program is.
+class Printer {
+  static constexpr size_t FLUSH_SIZE = 64 * 1024;
+
+  string buffer;
+  std::ostream *out = nullptr;
+  // Indentation for the deepest scope seen so far; a prefix of it is written
+  // for the current one.
+  string indent_str;
+  size_t depth = 0;
+  // Resolves istrings; printers of plain text can do without.
+  const Interner *interner = nullptr;
+
+  void wrote() {
+    if (out && buffer.size() >= FLUSH_SIZE) flush();
+  }
+
+ public:
+  Printer() = default;
+  explicit Printer(std::ostream &out);
+  explicit Printer(const Interner &interner);
+  Printer(const Interner &interner, std::ostream &out);
+  Printer(const Printer &) = delete;
+  Printer &operator=(const Printer &) = delete;
+  ~Printer();
+
+  Printer &operator<<(string_view s) {
+    buffer.append(s);
+    wrote();
+    return *this;
+  }
+
+  Printer &operator<<(char c) {
+    buffer.push_back(c);
+    wrote();
+    return *this;
+  }
+
+  Printer &operator<<(istring s) { return *this << interner->get_string(s); }
+  Printer &operator<<(uint64_t n);
+  Printer &operator<<(double f);
+
+  void indent() { *this << string_view(indent_str.data(), depth * 2); }
+  void scope_start();
+  void scope_end() { depth--; }
+
+  // Writes everything buffered so far to the stream, if there is one.
+  void flush();
+
+  // Hands over the output when printing into a string.
+  string take() { return std::move(buffer); }
+};
+
+} // namespace dasl::pt
+
+#endif // PRINTER_HXX
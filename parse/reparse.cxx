@@ -0,0 +1,149 @@
+#include <string>
+using std::string;
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+#include "driver.hxx"
+#include "incremental.hxx"
+#include "visit.hxx"
+
+using dasl::pt::Env;
+
+// Applies random edits to a program through an IncrementalParser and checks
+// after each one that the result matches a parse of the edited source from
+// scratch. Every edit is undone right after, so the program stays valid
+// most of the time and both the broken and the repaired state are checked.
+// Prints how long the incremental updates took.
+
+static void usage() {
+  std::cout << "usage: reparse [-s seed] [-n edits] file" << std::endl;
+}
+
+struct Edit {
+  size_t begin, end;
+  string text;
+};
+
+static Edit random_edit(std::mt19937_64 &rng, const string &source) {
+  static const char chars[] = "abcxyz019 \n.,:;()[]{}=+-<>\"";
+  auto pick = [&rng](size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng); };
+  size_t at = pick(source.size() + 1);
+  switch (pick(5)) {
+    case 0: return { at, at, string(1, chars[pick(sizeof chars - 1)]) };
+    case 1: return { at, std::min(source.size(), at + 1 + pick(3)), "" };
+    case 2: return { at, std::min(source.size(), at + 1 + pick(200)), "" };
+    case 3: return { at, at, pick(2) ? " end" : "val x = 1\n" };
+    default: return { at, std::min(source.size(), at + 1 + pick(8)), "name" };
+  }
+}
+
+// Appends the spans of the nodes of `st`, moved by `base`, in walk order.
+static void add_spans(const dasl::pt::St *st, size_t base, vector<Span> &spans) {
+  dasl::pt::walk_iterative(st, [&](const dasl::pt::PT &node) {
+    spans.push_back(Span{ uint32_t(base + node.span.begin), uint32_t(base + node.span.end) });
+    return true;
+  });
+}
+
+// Returns false if `ip` disagrees with a full parse of its source: on
+// whether it parses, on where the first diagnostic is if it does not, and on
+// what the tree prints and where its nodes are if it does. Messages may
+// differ, since a statement cut short reaches the end of its input where
+// the full parse sees the token that starts the next one.
+static bool check(const dasl::IncrementalParser &ip, dasl::Interner &interner) {
+  Env env(interner);
+  bool ok = dasl::parse_source(ip.source(), env) && env.errors.empty();
+  if (ok != ip.ok()) return false;
+  if (!ok) {
+    vector<dasl::pt::Diagnostic> errors = ip.errors();
+    if (env.errors.empty()) return !errors.empty();
+    return !errors.empty() && errors[0].span.begin == env.errors[0].span.begin;
+  }
+
+  dasl::pt::Printer incremental(interner);
+  ip.print(incremental);
+  if (incremental.take() != env.pt->to_string(env)) return false;
+
+  vector<Span> expected, spans;
+  for (auto *st : env.pt->statements) add_spans(st, 0, expected);
+  for (auto &parsed : ip.parsed()) add_spans(parsed.st, parsed.base, spans);
+  return spans.size() == expected.size() &&
+         std::equal(spans.begin(), spans.end(), expected.begin(), [](const Span &a, const Span &b) {
+           return a.begin == b.begin && a.end == b.end;
+         });
+}
+
+int main(int argc, char **argv) {
+  uint64_t seed = 1;
+  size_t edits = 100;
+  string path;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-s" && i + 1 < argc) {
+      seed = strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "-n" && i + 1 < argc) {
+      edits = strtoull(argv[++i], nullptr, 10);
+    } else if (arg[0] != '-' && path.empty()) {
+      path = arg;
+    } else {
+      usage();
+      return arg == "-h" ? 0 : 1;
+    }
+  }
+  if (path.empty()) {
+    usage();
+    return 1;
+  }
+
+  dasl::MappedFile file;
+  if (!file.open(path)) {
+    std::cout << "Failed to read file " << path << std::endl;
+    return 1;
+  }
+
+  dasl::Interner interner;
+  dasl::IncrementalParser ip(interner, &path);
+  auto start = std::chrono::steady_clock::now();
+  ip.reset(file.view());
+  std::chrono::duration<double> full = std::chrono::steady_clock::now() - start;
+  if (!check(ip, interner)) {
+    std::cout << "Failed initial parse of " << path << std::endl;
+    return 1;
+  }
+
+  std::mt19937_64 rng(seed);
+  double total = 0, worst = 0;
+  size_t reparsed = 0, updates = 0;
+  for (size_t i = 0; i < edits; i++) {
+    Edit e = random_edit(rng, ip.source());
+    Edit undo{ e.begin, e.begin + e.text.size(), ip.source().substr(e.begin, e.end - e.begin) };
+
+    for (Edit *step : { &e, &undo }) {
+      start = std::chrono::steady_clock::now();
+      ip.edit(step->begin, step->end, step->text);
+      std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+      total += d.count();
+      worst = std::max(worst, d.count());
+      reparsed += ip.reparsed_statements();
+      updates++;
+
+      if (!check(ip, interner)) {
+        std::cout << "Failed after edit " << i << " (" << step->begin << ", " << step->end << ", \""
+                  << step->text << "\") of " << path << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  std::cout << "Passed " << updates << " updates of " << path << " (" << ip.size() << " statements, full parse "
+            << full.count() * 1e6 << "us, update avg " << (updates ? total / updates * 1e6 : 0) << "us max "
+            << worst * 1e6 << "us, " << (updates ? double(reparsed) / updates : 0) << " statements reparsed)"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,508 @@
+#include "resolve.hxx"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "visit.hxx"
+#include "work_pool.hxx"
+
+namespace dasl::pt {
+
+Namespace name_space(Binding::Kind kind) {
+  switch (kind) {
+    case Binding::RECORD: return TYPES;
+    case Binding::MODULE: return MODULES;
+    default: return VALUES;
+  }
+}
+
+uint32_t Resolution::member(uint32_t scope, Namespace space, istring name) const {
+  auto &names = scopes[scope].names;
+  auto it = names.find(Scope::key(space, name));
+  return it == names.end() ? NO_BINDING : it->second;
+}
+
+namespace {
+
+// Statements of a module are resolved in slices of at most this many, which
+// are the tasks of a parallel resolve.
+constexpr size_t SLICE = 256;
+
+struct Unit {
+  vector<St *> *statements;
+  size_t begin, end;
+  uint32_t scope;
+};
+
+vector<St *> &members_of(St &st) {
+  if (st.tag == NodeKind::PROGRAM) return static_cast<Program &>(st).statements;
+  return static_cast<ModuleSt &>(st).statements;
+}
+
+// The kind and name of what `st` declares; false if it declares nothing.
+bool declaration(const St &st, Binding::Kind &kind, istring &name) {
+  switch (st.tag) {
+    case NodeKind::DEF_ST:
+      kind = Binding::DEF;
+      name = static_cast<const DefSt &>(st).name.val;
+      return true;
+    case NodeKind::VAL_ST:
+      kind = Binding::VAL;
+      name = static_cast<const ValSt &>(st).name.val;
+      return true;
+    case NodeKind::RECORD_ST:
+      kind = Binding::RECORD;
+      name = static_cast<const RecordSt &>(st).name.val;
+      return true;
+    case NodeKind::MODULE_ST:
+      kind = Binding::MODULE;
+      name = static_cast<const ModuleSt &>(st).name.val;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Resolves one unit against the declarations that are already in `global`.
+// Bindings and scopes it creates get provisional ids, counted on from the
+// end of `global`, and are renumbered when the units are merged in order;
+// `fixups` are the fields of the tree that hold such ids. The declarations
+// of the program and its modules are made by an instance whose `global` is
+// empty and that keeps its ids.
+class Resolver {
+  struct Work {
+    enum Kind : uint8_t {
+      NODE,        // resolve `node` and what is below it
+      BODY,        // the statements of a def body or if branch
+      MODULE,      // the statements of a module inside a body
+      DECLARE,     // declare the val `node` from here on
+      OPEN,        // open a `scope` scope for `node`
+      CLOSE,
+    } kind;
+    Scope::Kind scope;
+    PT *node;
+    vector<St *> *body;
+  };
+
+  struct Open {
+    uint32_t scope;
+    size_t undo;
+  };
+
+  const Resolution &global;
+  Interner &interner;
+  istring wildcard;
+  uint32_t first_binding, first_scope;
+  bool provisional;
+
+  uint32_t module = NO_SCOPE, current = NO_SCOPE;
+  vector<Work> work;
+  vector<Open> open;
+  vector<PT *> children;
+  // Names declared in the scopes open inside the unit, and what they
+  // shadowed, to restore when the scopes close.
+  unordered_map<uint64_t, uint32_t> visible;
+  vector<pair<uint64_t, uint32_t>> undo;
+
+ public:
+  vector<Binding> bindings;
+  vector<Scope> scopes;
+  vector<Diagnostic> errors;
+  vector<uint32_t *> fixups;
+
+  Resolver(const Resolution &global, Interner &interner, bool provisional)
+    : global(global), interner(interner), wildcard(interner.get("_")),
+      first_binding(uint32_t(global.bindings.size())), first_scope(uint32_t(global.scopes.size())),
+      provisional(provisional) {}
+
+  const Binding &binding(uint32_t id) const {
+    return id < first_binding ? global.bindings[id] : bindings[id - first_binding];
+  }
+  const Scope &scope(uint32_t id) const {
+    return id < first_scope ? global.scopes[id] : scopes[id - first_scope];
+  }
+  uint32_t member(uint32_t id, Namespace space, istring name) const {
+    auto &names = scope(id).names;
+    auto it = names.find(Scope::key(space, name));
+    return it == names.end() ? NO_BINDING : it->second;
+  }
+
+  uint32_t new_scope(Scope::Kind kind, uint32_t parent, const PT *node) {
+    scopes.push_back(Scope{ kind, parent, node });
+    return first_scope + uint32_t(scopes.size() - 1);
+  }
+
+  uint32_t new_binding(Binding::Kind kind, istring name, uint32_t scope, const PT *node) {
+    bindings.push_back(Binding{ kind, name, scope, NO_SCOPE, node });
+    return first_binding + uint32_t(bindings.size() - 1);
+  }
+
+  void set(uint32_t &field, uint32_t id) {
+    field = id;
+    if (provisional && id >= first_binding) fixups.push_back(&field);
+  }
+
+  string spelled(const SymbolRef &ref) const {
+    string s;
+    for (auto it = ref.modules.begin(); it != ref.modules.end(); it++)
+      s.append(interner.get_string(it->val)).append(".");
+    return s.append(interner.get_string(ref.name.val));
+  }
+
+  // Declares the members of module scope `scope`, the module statements
+  // among them and theirs, and cuts the other statements into `units` if
+  // it is given. A module opened again in the same scope gets the members
+  // of the new opening. Members get their slots a module at a time, in
+  // source order.
+  void declare_members(vector<St *> &statements, uint32_t scope, vector<Unit> *units) {
+    vector<pair<vector<St *> *, uint32_t>> pending{ { &statements, scope } }, inner;
+    while (!pending.empty()) {
+      auto [list, at] = pending.back();
+      pending.pop_back();
+      inner.clear();
+      for (auto it = list->begin(); it != list->end(); it++) {
+        St &st = **it;
+        Binding::Kind kind;
+        istring name;
+        if (!declaration(st, kind, name)) continue;
+        uint64_t key = Scope::key(name_space(kind), name);
+        auto &names = scopes[at - first_scope].names;
+        auto found = names.find(key);
+        if (kind == Binding::MODULE) {
+          uint32_t id = found == names.end() ? NO_BINDING : found->second;
+          if (id == NO_BINDING) {
+            id = new_binding(kind, name, at, &st);
+            bindings.back().members = new_scope(Scope::MODULE, at, &st);
+            scopes[at - first_scope].names.emplace(key, id);
+          }
+          set(st.binding, id);
+          inner.push_back({ &members_of(st), binding(id).members });
+          continue;
+        }
+        set(st.binding, new_binding(kind, name, at, &st));
+        if (found != names.end())
+          errors.push_back({ st.span, string(interner.get_string(name)) + " is already defined" });
+        else
+          names.emplace(key, st.binding);
+      }
+      if (units)
+        for (size_t begin = 0; begin < list->size(); begin += SLICE)
+          units->push_back({ list, begin, std::min(begin + SLICE, list->size()), at });
+      pending.insert(pending.end(), inner.rbegin(), inner.rend());
+    }
+  }
+
+  void declare_program(Program &program, vector<Unit> &units) {
+    uint32_t root = new_scope(Scope::MODULE, NO_SCOPE, &program);
+    declare_members(program.statements, root, &units);
+  }
+
+  void run(const Unit &unit) {
+    module = current = unit.scope;
+    open.push_back({ unit.scope, 0 });
+    for (size_t i = unit.end; i-- > unit.begin;) push_statement(*(*unit.statements)[i], true, false);
+    while (!work.empty()) {
+      Work w = work.back();
+      work.pop_back();
+      step(w);
+    }
+  }
+
+ private:
+  void bind(uint64_t key, uint32_t id) {
+    auto it = visible.find(key);
+    undo.push_back({ key, it == visible.end() ? NO_BINDING : it->second });
+    visible[key] = id;
+  }
+
+  // Looks `name` up in the scopes open in the unit, then in the module of
+  // the unit and the modules around it.
+  uint32_t find(Namespace space, istring name) const {
+    uint64_t key = Scope::key(space, name);
+    auto it = visible.find(key);
+    if (it != visible.end()) return it->second;
+    for (uint32_t s = module; s != NO_SCOPE; s = scope(s).parent) {
+      uint32_t id = member(s, space, name);
+      if (id != NO_BINDING) return id;
+    }
+    return NO_BINDING;
+  }
+
+  void resolve(const SymbolRef &ref, Namespace space) {
+    uint32_t id;
+    if (ref.modules.empty()) {
+      id = find(space, ref.name.val);
+    } else {
+      id = find(MODULES, ref.modules[0].val);
+      for (size_t i = 1; i < ref.modules.size() && id != NO_BINDING; i++)
+        id = member(binding(id).members, MODULES, ref.modules[i].val);
+      if (id != NO_BINDING) id = member(binding(id).members, space, ref.name.val);
+    }
+    if (id == NO_BINDING) errors.push_back({ ref.span, "unknown name " + spelled(ref) });
+    else set(ref.target, id);
+  }
+
+  // Declares a def, type or module of a body, which is visible in all of
+  // it.
+  void hoist(St &st) {
+    Binding::Kind kind;
+    istring name;
+    if (!declaration(st, kind, name) || kind == Binding::VAL) return;
+    uint64_t key = Scope::key(name_space(kind), name);
+    auto it = visible.find(key);
+    bool here = it != visible.end() && binding(it->second).scope == current;
+    if (kind == Binding::MODULE) {
+      uint32_t id = here ? it->second : NO_BINDING;
+      if (id == NO_BINDING) {
+        id = new_binding(kind, name, current, &st);
+        bindings.back().members = new_scope(Scope::MODULE, current, &st);
+        bind(key, id);
+      }
+      set(st.binding, id);
+      declare_members(members_of(st), binding(id).members, nullptr);
+      return;
+    }
+    set(st.binding, new_binding(kind, name, current, &st));
+    if (here) errors.push_back({ st.span, string(interner.get_string(name)) + " is already defined" });
+    else bind(key, st.binding);
+  }
+
+  void push(Work::Kind kind, PT *node) { work.push_back({ kind, Scope::BLOCK, node, nullptr }); }
+  void push_open(Scope::Kind scope, PT *node) { work.push_back({ Work::OPEN, scope, node, nullptr }); }
+  void push_body(vector<St *> &body) { work.push_back({ Work::BODY, Scope::BLOCK, nullptr, &body }); }
+
+  // Work is pushed in reverse, so it runs in source order.
+  void push_statement(St &st, bool in_module, bool nested) {
+    switch (st.tag) {
+      case NodeKind::VAL_ST:
+        // In a module the val is visible everywhere already.
+        if (!in_module) push(Work::DECLARE, &st);
+        push(Work::NODE, static_cast<ValSt &>(st).expr);
+        break;
+      case NodeKind::DEF_ST: {
+        auto &n = static_cast<DefSt &>(st);
+        push(Work::CLOSE, nullptr);
+        push_body(n.body);
+        for (auto it = n.args.rbegin(); it != n.args.rend(); it++) push(Work::NODE, *it);
+        if (n.type) push(Work::NODE, n.type);
+        push_open(Scope::DEF, &st);
+        break;
+      }
+      case NodeKind::RECORD_ST: {
+        auto &n = static_cast<RecordSt &>(st);
+        for (auto it = n.fields.rbegin(); it != n.fields.rend(); it++) push(Work::NODE, it->second);
+        break;
+      }
+      case NodeKind::MODULE_ST:
+        // Modules of the program are units of their own.
+        if (nested) push(Work::MODULE, &st);
+        break;
+      case NodeKind::EXPR_ST:
+        push(Work::NODE, static_cast<ExprSt &>(st).expr);
+        break;
+      case NodeKind::FOR_ST: {
+        auto &n = static_cast<ForSt &>(st);
+        push(Work::CLOSE, nullptr);
+        push(Work::NODE, n.pattern);
+        push_open(Scope::BLOCK, &st);
+        push(Work::NODE, n.container);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  void push_children(PT &node) {
+    size_t mark = children.size();
+    for_each_child(node, [this](PT *child) { children.push_back(child); });
+    for (size_t i = children.size(); i-- > mark;) push(Work::NODE, children[i]);
+    children.resize(mark);
+  }
+
+  void step(const Work &w) {
+    switch (w.kind) {
+      case Work::NODE:
+        node(*w.node);
+        break;
+      case Work::BODY:
+        for (auto it = w.body->begin(); it != w.body->end(); it++) hoist(**it);
+        for (auto it = w.body->rbegin(); it != w.body->rend(); it++) push_statement(**it, false, true);
+        break;
+      case Work::MODULE: {
+        auto &st = static_cast<St &>(*w.node);
+        uint32_t members = binding(st.binding).members;
+        open.push_back({ members, undo.size() });
+        current = members;
+        auto &names = scope(members).names;
+        for (auto it = names.begin(); it != names.end(); it++) bind(it->first, it->second);
+        push(Work::CLOSE, nullptr);
+        vector<St *> &statements = members_of(st);
+        for (auto it = statements.rbegin(); it != statements.rend(); it++) push_statement(**it, true, true);
+        break;
+      }
+      case Work::DECLARE: {
+        auto &st = static_cast<ValSt &>(*w.node);
+        set(st.binding, new_binding(Binding::VAL, st.name.val, current, &st));
+        bind(Scope::key(VALUES, st.name.val), st.binding);
+        break;
+      }
+      case Work::OPEN: {
+        uint32_t id = new_scope(w.scope, current, w.node);
+        scopes.back().first = first_binding + uint32_t(bindings.size());
+        open.push_back({ id, undo.size() });
+        current = id;
+        break;
+      }
+      case Work::CLOSE: {
+        Open o = open.back();
+        open.pop_back();
+        if (scope(o.scope).kind != Scope::MODULE)
+          scopes[o.scope - first_scope].end = first_binding + uint32_t(bindings.size());
+        while (undo.size() > o.undo) {
+          auto [key, id] = undo.back();
+          undo.pop_back();
+          if (id == NO_BINDING) visible.erase(key);
+          else visible[key] = id;
+        }
+        current = open.back().scope;
+        break;
+      }
+    }
+  }
+
+  void node(PT &node) {
+    switch (node.tag) {
+      case NodeKind::RECORD_TYPE:
+        resolve(static_cast<RecordType &>(node).symbol, TYPES);
+        break;
+
+      case NodeKind::SYMBOL_PAT: {
+        auto &n = static_cast<SymbolPat &>(node);
+        if (!n.symbol.modules.empty()) {
+          resolve(n.symbol, VALUES);
+        } else if (n.symbol.name.val.i != wildcard.i) {
+          set(n.symbol.target, new_binding(Binding::PAT, n.symbol.name.val, current, &n));
+          bind(Scope::key(VALUES, n.symbol.name.val), n.symbol.target);
+        }
+        push_children(node);
+        break;
+      }
+      case NodeKind::RECORD_PAT:
+        resolve(static_cast<RecordPat &>(node).record_name, TYPES);
+        push_children(node);
+        break;
+
+      case NodeKind::SYMBOL_EXPR:
+        resolve(static_cast<SymbolExpr &>(node).symbol, VALUES);
+        push_children(node);
+        break;
+      case NodeKind::CALL_EXPR:
+        resolve(static_cast<CallExpr &>(node).name, VALUES);
+        push_children(node);
+        break;
+      case NodeKind::RECORD_EXPR:
+        resolve(static_cast<RecordExpr &>(node).name, TYPES);
+        push_children(node);
+        break;
+
+      case NodeKind::IF_ELSE_EXPR: {
+        auto &n = static_cast<IfElseExpr &>(node);
+        if (n.else_body) {
+          push(Work::CLOSE, nullptr);
+          push_body(*n.else_body);
+          push_open(Scope::BLOCK, &n);
+        }
+        push(Work::CLOSE, nullptr);
+        push_body(n.body);
+        push_open(Scope::BLOCK, &n);
+        push(Work::NODE, n.cond);
+        if (n.type) push(Work::NODE, n.type);
+        break;
+      }
+      case NodeKind::CASE_EXPR: {
+        auto &n = static_cast<CaseExpr &>(node);
+        for (auto it = n.cases.rbegin(); it != n.cases.rend(); it++) {
+          push(Work::CLOSE, nullptr);
+          push(Work::NODE, it->second);
+          push(Work::NODE, it->first);
+          push_open(Scope::ARM, &n);
+        }
+        push(Work::NODE, n.value);
+        if (n.type) push(Work::NODE, n.type);
+        break;
+      }
+
+      default:
+        push_children(node);
+        break;
+    }
+  }
+};
+
+void merge(Resolver &unit, uint32_t first_binding, uint32_t first_scope, Resolution &out) {
+  uint32_t binding_base = uint32_t(out.bindings.size()), scope_base = uint32_t(out.scopes.size());
+  auto binding = [&](uint32_t id) { return id == NO_BINDING || id < first_binding ? id : id - first_binding + binding_base; };
+  auto scope = [&](uint32_t id) { return id == NO_SCOPE || id < first_scope ? id : id - first_scope + scope_base; };
+
+  for (auto it = unit.bindings.begin(); it != unit.bindings.end(); it++) {
+    it->scope = scope(it->scope);
+    it->members = scope(it->members);
+    out.bindings.push_back(*it);
+  }
+  for (auto it = unit.scopes.begin(); it != unit.scopes.end(); it++) {
+    it->parent = scope(it->parent);
+    if (it->kind != Scope::MODULE) {
+      it->first = binding(it->first);
+      it->end = binding(it->end);
+    }
+    for (auto name = it->names.begin(); name != it->names.end(); name++) name->second = binding(name->second);
+    out.scopes.push_back(std::move(*it));
+  }
+  for (auto it = unit.fixups.begin(); it != unit.fixups.end(); it++) **it = binding(**it);
+  out.errors.insert(out.errors.end(), unit.errors.begin(), unit.errors.end());
+}
+
+void resolve(Env &env, Resolution &out, WorkPool *pool) {
+  vector<Unit> units;
+  {
+    Resolver declarer(out, env.interner, false);
+    declarer.declare_program(*env.pt, units);
+    out.bindings = std::move(declarer.bindings);
+    out.scopes = std::move(declarer.scopes);
+    out.errors = std::move(declarer.errors);
+  }
+
+  // Units only read `out` until they are all done.
+  vector<unique_ptr<Resolver>> resolvers;
+  for (size_t i = 0; i < units.size(); i++) resolvers.push_back(std::make_unique<Resolver>(out, env.interner, true));
+  if (pool) {
+    std::mutex lock;
+    std::condition_variable done;
+    size_t left = units.size();
+    for (size_t i = 0; i < units.size(); i++) {
+      pool->submit([&, i] {
+        resolvers[i]->run(units[i]);
+        std::lock_guard<std::mutex> guard(lock);
+        if (--left == 0) done.notify_one();
+      });
+    }
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [&left] { return left == 0; });
+  } else {
+    for (size_t i = 0; i < units.size(); i++) resolvers[i]->run(units[i]);
+  }
+
+  uint32_t first_binding = uint32_t(out.bindings.size()), first_scope = uint32_t(out.scopes.size());
+  for (auto it = resolvers.begin(); it != resolvers.end(); it++) merge(**it, first_binding, first_scope, out);
+}
+
+} // namespace
+
+void resolve(Env &env, Resolution &out) { resolve(env, out, nullptr); }
+
+void resolve(Env &env, Resolution &out, WorkPool &pool) { resolve(env, out, &pool); }
+
+} // namespace dasl::pt
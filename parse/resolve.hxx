@@ -0,0 +1,92 @@
+#ifndef RESOLVE_HXX
+#define RESOLVE_HXX
+
+#include <cstdint>
+#include <unordered_map>
+using std::unordered_map;
+#include <vector>
+using std::vector;
+
+#include "parse_tree.hxx"
+
+namespace dasl {
+class WorkPool;
+}
+
+// Binds every name in a program to what declares it. Declarations get dense
+// slots, indices into Resolution::bindings, and the tree is annotated in
+// place: St::binding on def, val, type and module statements, and
+// SymbolRef::target on every symbol, so later passes index an array instead
+// of looking names up.
+//
+// Values (vals, defs and names bound by patterns), record types and modules
+// have a namespace each. In a module, and in the program, every declaration
+// is visible throughout, so defs can call each other in any order. In the
+// body of a def or a branch of an if, defs, types and modules are visible
+// throughout the body but a val only from the next statement on, and a val
+// may shadow an earlier one. Def arguments are visible in the body and the
+// names a case pattern binds in its arm. `_` binds nothing.
+//
+// A module opened twice in the same scope is one module with the members of
+// both. `a.b.c` looks `a` up as a module like any other name and `b` and `c`
+// among the members of the module before them.
+namespace dasl::pt {
+
+constexpr uint32_t NO_SCOPE = ~0U;
+
+enum Namespace : uint8_t { VALUES, TYPES, MODULES };
+
+struct Binding {
+  enum Kind : uint8_t { VAL, DEF, RECORD, MODULE, PAT } kind;
+  istring name;
+  // The scope the name is declared in and, for a module, the scope of its
+  // members.
+  uint32_t scope;
+  uint32_t members = NO_SCOPE;
+  // The statement or SymbolPat that declares it; for a module, its first
+  // opening.
+  const PT *node;
+};
+
+Namespace name_space(Binding::Kind kind);
+
+struct Scope {
+  enum Kind : uint8_t { MODULE, DEF, BLOCK, ARM } kind;
+  uint32_t parent;
+  // The Program, ModuleSt, DefSt, IfElseExpr or CaseExpr that opens it.
+  const PT *node;
+  // DEF, BLOCK and ARM: the slots of the bindings declared in the scope or
+  // in the scopes inside it are [first, end), so a def's locals can live
+  // in a frame indexed by `slot - first`.
+  uint32_t first = 0, end = 0;
+  // MODULE: the members, keyed by name and namespace (see key()).
+  unordered_map<uint64_t, uint32_t> names;
+
+  static uint64_t key(Namespace space, istring name) { return uint64_t(name.i) << 2 | space; }
+};
+
+struct Resolution {
+  vector<Binding> bindings;
+  // Scope 0 is the program.
+  vector<Scope> scopes;
+  // Names that are not declared anywhere they can be seen from, and names
+  // declared twice in one scope.
+  vector<Diagnostic> errors;
+
+  // The member `name` of module scope `scope`, or NO_BINDING.
+  uint32_t member(uint32_t scope, Namespace space, istring name) const;
+};
+
+// Resolves env.pt into `out`, which must be empty. Runs in time linear in
+// the size of the tree. The tree must not share nodes (see hash_cons.hxx):
+// share after resolving, if at all.
+void resolve(Env &env, Resolution &out);
+
+// Same, resolving the statements of independent modules, and slices of
+// long ones, on `pool`. The result is the same as that of resolve(). Must
+// not be called from a task running on `pool`.
+void resolve(Env &env, Resolution &out, WorkPool &pool);
+
+} // namespace dasl::pt
+
+#endif // RESOLVE_HXX
@@ -0,0 +1,382 @@
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+using std::string;
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "lexer.hxx"
+
+// The scanner behind LexerBackend::SIMD. It follows the rules of lexer.l to
+// the letter, longest match first and earlier rules on a tie, including
+// their odd corners: a lone 0 is not a number, octal literals skip their
+// first digit and a float needs an exponent.
+//
+// Runs of whitespace, id characters, digits and string contents are
+// classified a block of 32 (AVX2) or 16 (SSE2) bytes at a time, with a
+// table driven loop for the tail of the input and for other targets.
+
+namespace dasl {
+
+namespace {
+
+using token = Parser::token;
+
+enum CharClass : uint8_t {
+  BLANK = 1,   // space and tab
+  NEWLINE = 2,
+  DIGIT = 4,
+  IDENT = 8,   // [a-zA-Z0-9_'?]
+  HEX = 16,
+  OCTAL = 32,
+  STOP = 64,   // ends the plain part of a string: " and backslash
+};
+
+struct ClassTable {
+  uint8_t c[256];
+};
+
+constexpr ClassTable make_classes() {
+  ClassTable t{};
+  t.c[uint8_t(' ')] = t.c[uint8_t('\t')] = BLANK;
+  t.c[uint8_t('\n')] = NEWLINE;
+  for (int i = '0'; i <= '9'; i++) t.c[i] = DIGIT | IDENT | HEX | (i <= '7' ? OCTAL : 0);
+  for (int i = 'a'; i <= 'z'; i++) t.c[i] = t.c[i - 'a' + 'A'] = IDENT | (i <= 'f' ? HEX : 0);
+  t.c[uint8_t('_')] = t.c[uint8_t('\'')] = t.c[uint8_t('?')] = IDENT;
+  t.c[uint8_t('"')] = t.c[uint8_t('\\')] = STOP;
+  return t;
+}
+
+constexpr ClassTable classes = make_classes();
+
+inline bool is(char c, uint8_t cls) { return classes.c[uint8_t(c)] & cls; }
+
+#if defined(__AVX2__)
+
+constexpr size_t BLOCK = 32;
+using Vec = __m256i;
+inline Vec load(const char *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+inline Vec splat(char c) { return _mm256_set1_epi8(c); }
+inline Vec eq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+inline Vec gt(Vec a, Vec b) { return _mm256_cmpgt_epi8(a, b); }
+inline Vec or_(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+inline Vec and_(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+inline uint32_t bits(Vec v) { return uint32_t(_mm256_movemask_epi8(v)); }
+
+#elif defined(__SSE2__)
+
+constexpr size_t BLOCK = 16;
+using Vec = __m128i;
+inline Vec load(const char *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+inline Vec splat(char c) { return _mm_set1_epi8(c); }
+inline Vec eq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+inline Vec gt(Vec a, Vec b) { return _mm_cmpgt_epi8(a, b); }
+inline Vec or_(Vec a, Vec b) { return _mm_or_si128(a, b); }
+inline Vec and_(Vec a, Vec b) { return _mm_and_si128(a, b); }
+inline uint32_t bits(Vec v) { return uint32_t(_mm_movemask_epi8(v)); }
+
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+// Bytes >= 0x80 are negative as signed chars, so they fall outside every
+// range below.
+inline Vec in_range(Vec v, char lo, char hi) { return and_(gt(v, splat(lo - 1)), gt(splat(hi + 1), v)); }
+
+inline uint32_t digit_bits(Vec v) { return bits(in_range(v, '0', '9')); }
+
+inline uint32_t ident_bits(Vec v) {
+  Vec letter = in_range(or_(v, splat(0x20)), 'a', 'z');
+  Vec other = or_(or_(eq(v, splat('_')), eq(v, splat('\''))), eq(v, splat('?')));
+  return bits(or_(or_(letter, in_range(v, '0', '9')), other));
+}
+
+inline uint32_t stop_bits(Vec v) { return bits(or_(eq(v, splat('"')), eq(v, splat('\\')))); }
+
+constexpr uint32_t FULL = BLOCK == 32 ? ~0U : 0xffffU;
+
+// Skips the bytes for which `in` sets a bit in a block and `is_in` holds for
+// a single byte.
+template <typename In, typename IsIn>
+inline const char *skip(const char *p, const char *end, In in, IsIn is_in) {
+  while (size_t(end - p) >= BLOCK) {
+    uint32_t out = ~in(load(p)) & FULL;
+    if (out) return p + __builtin_ctz(out);
+    p += BLOCK;
+  }
+  while (p < end && is_in(*p)) p++;
+  return p;
+}
+
+inline const char *skip_digits(const char *p, const char *end) {
+  return skip(p, end, digit_bits, [](char c) { return is(c, DIGIT); });
+}
+inline const char *skip_ident(const char *p, const char *end) {
+  return skip(p, end, ident_bits, [](char c) { return is(c, IDENT); });
+}
+inline const char *find_stop(const char *p, const char *end) {
+  return skip(p, end, [](Vec v) { return ~stop_bits(v); }, [](char c) { return !is(c, STOP); });
+}
+
+#else
+
+inline const char *skip_class(const char *p, const char *end, uint8_t cls) {
+  while (p < end && is(*p, cls)) p++;
+  return p;
+}
+
+inline const char *skip_digits(const char *p, const char *end) { return skip_class(p, end, DIGIT); }
+inline const char *skip_ident(const char *p, const char *end) { return skip_class(p, end, IDENT); }
+inline const char *find_stop(const char *p, const char *end) {
+  while (p < end && !is(*p, STOP)) p++;
+  return p;
+}
+
+#endif
+
+// Skips spaces, tabs and newlines, adding a line for each newline. `p` is at
+// offset `at` of the input. Returns where the whitespace ends.
+inline const char *skip_space(const char *p, const char *end, uint32_t at, LineTable &lines) {
+  const char *begin = p;
+#if defined(__AVX2__) || defined(__SSE2__)
+  while (size_t(end - p) >= BLOCK) {
+    Vec v = load(p);
+    uint32_t newline = bits(eq(v, splat('\n')));
+    uint32_t space = bits(or_(eq(v, splat(' ')), eq(v, splat('\t')))) | newline;
+    uint32_t out = ~space & FULL;
+    uint32_t run = out ? (1U << __builtin_ctz(out)) - 1 : FULL;
+    for (uint32_t nl = newline & run; nl; nl &= nl - 1)
+      lines.add_line(at + uint32_t(p - begin) + __builtin_ctz(nl) + 1);
+    if (out) return p + __builtin_ctz(out);
+    p += BLOCK;
+  }
+#endif
+  for (; p < end; p++) {
+    if (*p == '\n') lines.add_line(at + uint32_t(p - begin) + 1);
+    else if (!is(*p, BLANK)) break;
+  }
+  return p;
+}
+
+// Keywords are found with a perfect hash on the first two bytes, the last
+// byte and the length. Every keyword is at least two bytes long and no two
+// of them share a slot, which the static_assert below checks.
+struct Keyword {
+  const char *text = nullptr;
+  size_t size = 0;
+  token::token_kind_type kind = token::TOKEN_END;
+};
+
+constexpr Keyword keywords[] = {
+  { "end", 3, token::TOKEN_KW_END },       { "def", 3, token::TOKEN_KW_DEF },
+  { "module", 6, token::TOKEN_KW_MODULE }, { "do", 2, token::TOKEN_KW_DO },
+  { "val", 3, token::TOKEN_KW_VAL },       { "if", 2, token::TOKEN_KW_IF },
+  { "then", 4, token::TOKEN_KW_THEN },     { "else", 4, token::TOKEN_KW_ELSE },
+  { "for", 3, token::TOKEN_KW_FOR },       { "in", 2, token::TOKEN_KW_IN },
+  { "case", 4, token::TOKEN_KW_CASE },     { "of", 2, token::TOKEN_KW_OF },
+  { "type", 4, token::TOKEN_KW_TYPE },     { "int", 3, token::TOKEN_KW_INT },
+  { "float", 5, token::TOKEN_KW_FLOAT },   { "bool", 4, token::TOKEN_KW_BOOL },
+  { "true", 4, token::TOKEN_KW_TRUE },     { "false", 5, token::TOKEN_KW_FALSE },
+  { "atom", 4, token::TOKEN_KW_ATOM },     { "any", 3, token::TOKEN_KW_ANY },
+  { "string", 6, token::TOKEN_KW_STRING }, { "map", 3, token::TOKEN_KW_MAP },
+  { "list", 4, token::TOKEN_KW_LIST },     { "and", 3, token::TOKEN_BAND },
+  { "or", 2, token::TOKEN_BOR },           { "xor", 3, token::TOKEN_BXOR },
+};
+
+constexpr size_t KEYWORD_SLOTS = 64;
+constexpr size_t MAX_KEYWORD = 6;
+
+constexpr size_t keyword_hash(const char *s, size_t n) {
+  return (uint8_t(s[0]) * 7 + uint8_t(s[1]) * 19 + uint8_t(s[n - 1]) + n) & (KEYWORD_SLOTS - 1);
+}
+
+struct KeywordTable {
+  Keyword slots[KEYWORD_SLOTS];
+  bool perfect = true;
+};
+
+constexpr KeywordTable make_keywords() {
+  KeywordTable t{};
+  for (const Keyword &k : keywords) {
+    Keyword &slot = t.slots[keyword_hash(k.text, k.size)];
+    if (slot.text) t.perfect = false;
+    slot = k;
+  }
+  return t;
+}
+
+constexpr KeywordTable keyword_table = make_keywords();
+static_assert(keyword_table.perfect, "two keywords hash to the same slot");
+
+inline token::token_kind_type keyword(const char *s, size_t n) {
+  if (n < 2 || n > MAX_KEYWORD) return token::TOKEN_END;
+  const Keyword &k = keyword_table.slots[keyword_hash(s, n)];
+  return k.size == n && std::memcmp(k.text, s, n) == 0 ? k.kind : token::TOKEN_END;
+}
+
+// Like strtoull on the digits in [p, end): saturates at UINT64_MAX.
+inline uint64_t to_uint(const char *p, const char *end, unsigned base) {
+  uint64_t n = 0;
+  for (; p < end; p++) {
+    unsigned d = is(*p, DIGIT) ? *p - '0' : (*p | 0x20) - 'a' + 10;
+    if (n > (UINT64_MAX - d) / base) return UINT64_MAX;
+    n = n * base + d;
+  }
+  return n;
+}
+
+// Like strtod, which returns infinity or a denormal when the value is out of
+// range where from_chars gives up.
+inline double to_double(const char *p, const char *end) {
+  double f = 0;
+  if (std::from_chars(p, end, f).ec == std::errc()) return f;
+  return std::strtod(string(p, end).c_str(), nullptr);
+}
+
+// The length of the float at `p`, or 0 if there is none:
+// [0-9]*([0-9]\.?|\.[0-9])[0-9]*([Ee][-+]?[0-9]+)
+inline size_t float_length(const char *p, const char *end) {
+  const char *q = skip_digits(p, end);
+  bool digits = q != p;
+  if (q < end && *q == '.') {
+    const char *r = skip_digits(q + 1, end);
+    digits = digits || r != q + 1;
+    q = r;
+  }
+  if (!digits || q == end || (*q != 'e' && *q != 'E')) return 0;
+  q++;
+  if (q < end && (*q == '-' || *q == '+')) q++;
+  const char *r = skip_digits(q, end);
+  return r == q ? 0 : r - p;
+}
+
+} // namespace
+
+Parser::symbol_type Lexer::scan_simd() {
+  // `input` starts at offset `base`.
+  const char *data = input.data(), *end = data + input.size();
+  auto offset = [&](const char *at) { return int(base + (at - data)); };
+
+  while (true) {
+    const char *p = data + (m_location - base);
+    const char *q = skip_space(p, end, m_location, lines);
+    if (q != p) token_start = offset(q) - 1;
+    m_location = offset(q);
+    if (q == end) return Parser::make_END(Span{ uint32_t(m_location), uint32_t(m_location) });
+
+    p = q;
+    token_start = offset(p);
+    auto span = [&]() {
+      m_location = offset(q);
+      return Span{ uint32_t(token_start), uint32_t(m_location) };
+    };
+    auto simple = [&](size_t n, token::token_kind_type kind) {
+      q = p + n;
+      return Parser::symbol_type(kind, span());
+    };
+    auto next_is = [&](char c) { return p + 1 < end && p[1] == c; };
+
+    char c = *p;
+    if (is(c, IDENT) && !is(c, DIGIT)) {
+      q = skip_ident(p + 1, end);
+      token::token_kind_type kind = keyword(p, q - p);
+      if (kind != token::TOKEN_END) return Parser::symbol_type(kind, span());
+      return Parser::make_ID(interner.get(string_view(p, q - p)), span());
+    }
+
+    if (is(c, DIGIT) || c == '.') {
+      if (size_t n = float_length(p, end)) {
+        q = p + n;
+        return Parser::make_FLOAT(to_double(p, q), span());
+      }
+      if (c == '0' && next_is('x') && p + 2 < end && is(p[2], HEX)) {
+        q = p + 2;
+        while (q < end && is(*q, HEX)) q++;
+        return Parser::make_INT(to_uint(p + 2, q, 16), span());
+      }
+      if (c == '0' && p + 1 < end && is(p[1], OCTAL)) {
+        q = p + 1;
+        while (q < end && is(*q, OCTAL)) q++;
+        // lexer.l converts from yytext + 2.
+        return Parser::make_INT(to_uint(p + 2, q, 8), span());
+      }
+      if (c != '0' && c != '.') {
+        q = skip_digits(p, end);
+        return Parser::make_INT(to_uint(p, q, 10), span());
+      }
+      if (c == '.') return simple(1, token::TOKEN_DOT);
+    }
+
+    switch (c) {
+      case '"': {
+        // \"(\\.|[^"\\])*\" where . is anything but a newline.
+        q = p + 1;
+        while (true) {
+          q = find_stop(q, end);
+          if (q == end || *q == '"') break;
+          if (q + 1 == end || q[1] == '\n') {
+            q = end;
+            break;
+          }
+          q += 2;
+        }
+        if (q == end) break;
+        q++;
+        for (const char *r = p + 1; (r = static_cast<const char *>(std::memchr(r, '\n', q - r))); r++)
+          lines.add_line(offset(r) + 1);
+        return Parser::make_STRING(interner.get(string_view(p + 1, q - p - 2)), span());
+      }
+      case ':':
+        if (p + 1 < end && is(p[1], IDENT)) {
+          q = skip_ident(p + 1, end);
+          return Parser::make_ATOM(interner.get(string_view(p + 1, q - p - 1)), span());
+        }
+        return next_is(':') ? simple(2, token::TOKEN_TAIL) : simple(1, token::TOKEN_COLON);
+      case '[': return simple(1, token::TOKEN_SQ_BOPEN);
+      case ']': return simple(1, token::TOKEN_SQ_BCLOSE);
+      case '{': return simple(1, token::TOKEN_CBOPEN);
+      case '}': return simple(1, token::TOKEN_CBCLOSE);
+      case '(': return simple(1, token::TOKEN_POPEN);
+      case ')': return simple(1, token::TOKEN_PCLOSE);
+      case ',': return simple(1, token::TOKEN_COMMA);
+      case ';': return simple(1, token::TOKEN_SEMICOLON);
+      case '+': return simple(1, token::TOKEN_ADD);
+      case '-': return simple(1, token::TOKEN_SUB);
+      case '*': return simple(1, token::TOKEN_MUL);
+      case '/': return simple(1, token::TOKEN_DIV);
+      case '%': return simple(1, token::TOKEN_MOD);
+      case '~': return simple(1, token::TOKEN_INV);
+      case '>':
+        if (next_is('>')) return simple(2, token::TOKEN_RSH);
+        return next_is('=') ? simple(2, token::TOKEN_GTE) : simple(1, token::TOKEN_GT);
+      case '<':
+        if (next_is('<')) return simple(2, token::TOKEN_LSH);
+        return next_is('=') ? simple(2, token::TOKEN_LTE) : simple(1, token::TOKEN_LT);
+      case '=':
+        if (next_is('>')) return simple(2, token::TOKEN_ARROW);
+        return next_is('=') ? simple(2, token::TOKEN_EQ) : simple(1, token::TOKEN_ASSIGN);
+      case '!': return next_is('=') ? simple(2, token::TOKEN_NEQ) : simple(1, token::TOKEN_NOT);
+      case '|': return next_is('|') ? simple(2, token::TOKEN_LOR) : simple(1, token::TOKEN_BAR);
+      case '&':
+        if (next_is('&')) return simple(2, token::TOKEN_LAND);
+        break;
+      case '^':
+        if (next_is('^')) return simple(2, token::TOKEN_LXOR);
+        break;
+      default:
+        break;
+    }
+
+    // flex's `.` rule; yytext stops at a NUL byte.
+    q = p + 1;
+    errors.push_back({ span(), string("unknown character [") + (c ? string(1, c) : string()) + "]" });
+  }
+}
+
+} // namespace dasl
@@ -0,0 +1,22 @@
+#include "source_map.hxx"
+
+#include <algorithm>
+#include <ostream>
+
+namespace dasl {
+
+std::ostream &operator<<(std::ostream &out, const Span &span) {
+  return out << span.begin << "-" << span.end;
+}
+
+LineTable::LineTable(string_view source, const string *filename) : filename(filename) {
+  for (size_t i = source.find('\n'); i != string_view::npos; i = source.find('\n', i + 1))
+    starts.push_back(i + 1);
+}
+
+LineTable::Position LineTable::position(uint32_t offset) const {
+  size_t line = std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+  return { uint32_t(line), offset - starts[line - 1] + 1 };
+}
+
+} // namespace dasl
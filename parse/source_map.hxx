@@ -0,0 +1,57 @@
+#ifndef SOURCE_MAP_HXX
+#define SOURCE_MAP_HXX
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+using std::string;
+#include <string_view>
+using std::string_view;
+#include <vector>
+using std::vector;
+
+namespace dasl {
+
+// Bytes [begin, end) of a source. This is the parser's location type, so it
+// is what every token, node and diagnostic carries; line and column are only
+// worked out from a LineTable when something is shown to a user.
+struct Span {
+  uint32_t begin = 0;
+  uint32_t end = 0;
+
+  uint32_t length() const { return end - begin; }
+};
+
+std::ostream &operator<<(std::ostream &out, const Span &span);
+
+// Offsets at which the lines of a source start. The lexer adds one entry
+// per newline as it goes, so a table costs nothing to build for sources that
+// were lexed anyway.
+class LineTable {
+  vector<uint32_t> starts{ 0 };
+
+ public:
+  struct Position {
+    uint32_t line;
+    uint32_t column;
+  };
+
+  // Name shown in diagnostics, if any. Must outlive the table.
+  const string *filename = nullptr;
+
+  LineTable() = default;
+  explicit LineTable(string_view source, const string *filename = nullptr);
+
+  void add_line(uint32_t start) { starts.push_back(start); }
+  // Adds the lines of `rest`, a table for the part of the same source that
+  // follows this one.
+  void append(const LineTable &rest) { starts.insert(starts.end(), rest.starts.begin() + 1, rest.starts.end()); }
+  size_t lines() const { return starts.size(); }
+
+  // 1-based line and column of byte `offset`.
+  Position position(uint32_t offset) const;
+};
+
+} // namespace dasl
+
+#endif // SOURCE_MAP_HXX
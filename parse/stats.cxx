@@ -0,0 +1,105 @@
+#include "stats.hxx"
+
+#include <cstdlib>
+#include <cxxabi.h>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#include <parser.hxx>
+
+namespace dasl::stats {
+
+Totals totals = {};
+
+namespace {
+
+struct NodeCounter {
+  const char *type_name;
+  std::atomic<uint64_t> count{ 0 };
+
+  explicit NodeCounter(const char *type_name) : type_name(type_name) {}
+};
+
+std::mutex nodes_lock;
+// A deque, so counters handed out never move.
+std::deque<NodeCounter> nodes;
+
+void write_string(std::ostream &out, const std::string &s) {
+  out << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') out << '\\';
+    out << c;
+  }
+  out << '"';
+}
+
+std::string demangle(const char *name) {
+  int status;
+  char *s = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status != 0) return name;
+  std::string result(s);
+  std::free(s);
+  return result;
+}
+
+} // namespace
+
+std::atomic<uint64_t> &node_counter(const char *type_name) {
+  std::lock_guard<std::mutex> guard(nodes_lock);
+  return nodes.emplace_back(type_name).count;
+}
+
+void write_json(std::ostream &out) {
+  static const char *counter_names[] = { "hits", "misses", "grows", "slots_allocated" };
+  static const char *phase_names[] = { "read", "lex", "parse", "print" };
+  auto load = [](const std::atomic<uint64_t> &a) { return a.load(std::memory_order_relaxed); };
+
+  out << "{\"phases\": {";
+  for (int p = 0; p < PHASES; p++) {
+    out << (p ? ", " : "") << '"' << phase_names[p] << "\": {\"count\": " << load(totals.phase_count[p])
+        << ", \"seconds\": " << load(totals.phase_ns[p]) / 1e9 << "}";
+  }
+
+  out << "}, \"tokens\": {";
+  bool first = true;
+  for (int k = 0; k < MAX_TOKEN_KINDS && k < Parser::YYNTOKENS; k++) {
+    if (!load(totals.tokens[k])) continue;
+    out << (first ? "" : ", ");
+    write_string(out, Parser::symbol_name(Parser::symbol_kind_type(k)));
+    out << ": " << load(totals.tokens[k]);
+    first = false;
+  }
+
+  out << "}, \"nodes\": {";
+  {
+    std::lock_guard<std::mutex> guard(nodes_lock);
+    for (auto it = nodes.begin(); it != nodes.end(); it++) {
+      out << (it == nodes.begin() ? "" : ", ");
+      write_string(out, demangle(it->type_name));
+      out << ": " << load(it->count);
+    }
+  }
+
+  out << "}, \"interner\": {";
+  for (int c = 0; c < COUNTERS; c++)
+    out << (c ? ", " : "") << '"' << counter_names[c] << "\": " << load(totals.counters[c]);
+  out << "}}";
+}
+
+void report() {
+  if (!enabled) return;
+  const char *path = std::getenv("DASL_STATS_FILE");
+  if (!path) {
+    write_json(std::cerr);
+    std::cerr << std::endl;
+    return;
+  }
+  std::ofstream out(path);
+  write_json(out);
+  out << std::endl;
+}
+
+} // namespace dasl::stats
@@ -0,0 +1,90 @@
+#ifndef STATS_HXX
+#define STATS_HXX
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <typeinfo>
+
+// Counters and phase timers for the front end. They are compiled in only
+// when DASL_STATS is defined (`make stats`); otherwise every hook below is an
+// empty inline function and costs nothing.
+//
+// Counters are process wide relaxed atomics, so drivers that parse on many
+// threads still get exact totals.
+namespace dasl::stats {
+
+#ifdef DASL_STATS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+// INTERNER_SLOTS_ALLOCATED adds up the size of every hash table an Interner
+// allocates, including those a grow replaced; it is not the current size.
+enum Counter { INTERNER_HITS, INTERNER_MISSES, INTERNER_GROWS, INTERNER_SLOTS_ALLOCATED, COUNTERS };
+enum Phase { READ, LEX, PARSE, PRINT, PHASES };
+
+constexpr int MAX_TOKEN_KINDS = 128;
+
+struct Totals {
+  std::atomic<uint64_t> counters[COUNTERS];
+  std::atomic<uint64_t> tokens[MAX_TOKEN_KINDS];
+  std::atomic<uint64_t> phase_count[PHASES];
+  std::atomic<uint64_t> phase_ns[PHASES];
+};
+
+extern Totals totals;
+
+// Registers a node type by its mangled name and returns its counter.
+std::atomic<uint64_t> &node_counter(const char *type_name);
+
+inline void add(Counter c, uint64_t n = 1) {
+  if constexpr (enabled) totals.counters[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void count_token(int kind) {
+  if constexpr (enabled)
+    if (kind >= 0 && kind < MAX_TOKEN_KINDS) totals.tokens[kind].fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline void count_node() {
+  if constexpr (enabled) {
+    static std::atomic<uint64_t> &counter = node_counter(typeid(T).name());
+    counter.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Adds the time from construction to destruction to a phase. Phases may
+// nest. Timers are too slow to wrap every token, so LEX is timed around
+// loops that only lex; where the parser pulls tokens, lexing is part of PARSE.
+class Timer {
+#ifdef DASL_STATS
+  Phase phase;
+  std::chrono::steady_clock::time_point start;
+
+ public:
+  explicit Timer(Phase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+  ~Timer() {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    totals.phase_count[phase].fetch_add(1, std::memory_order_relaxed);
+    totals.phase_ns[phase].fetch_add(ns.count(), std::memory_order_relaxed);
+  }
+#else
+ public:
+  explicit Timer(Phase) {}
+#endif
+};
+
+// Writes everything counted so far as one JSON object.
+void write_json(std::ostream &out);
+
+// For the drivers: writes the JSON to the file named by $DASL_STATS_FILE,
+// or to stderr. Does nothing unless stats are compiled in.
+void report();
+
+} // namespace dasl::stats
+
+#endif // STATS_HXX
@@ -0,0 +1,270 @@
+#ifndef VISIT_HXX
+#define VISIT_HXX
+
+#include <type_traits>
+#include <vector>
+using std::vector;
+
+#include "parse_tree.hxx"
+
+// Passes over the PT without a virtual method per pass. visit() switches on
+// a node's tag and calls a function with the node cast to its real type;
+// for_each_child() lists the children of a node; walk() and walk_iterative()
+// combine the two into a pre- and post-order traversal of a whole tree.
+//
+// Everything here works on both `PT` and `const PT`, and the callbacks get
+// nodes of the same constness.
+namespace dasl::pt {
+
+// `T`, const if `Node` is.
+template <typename T, typename Node>
+using like = std::conditional_t<std::is_const_v<Node>, const T, T>;
+
+// Returns `node` as a T if that is what it is, or nullptr.
+template <typename T, typename Node>
+like<T, Node> *node_cast(Node *node) {
+  return node && node->tag == T::KIND ? static_cast<like<T, Node> *>(node) : nullptr;
+}
+
+// Calls `f` with `node` cast to its concrete type and returns what it
+// returns, so `f` is usually a generic lambda or an overload set. Values,
+// ids and symbols (tagged NONE) are passed as they are.
+template <typename Node, typename F>
+decltype(auto) visit(Node &node, F &&f) {
+#define DASL_VISIT(T) \
+  case T::KIND: return f(static_cast<like<T, Node> &>(node));
+  switch (node.tag) {
+    DASL_VISIT(ListType)
+    DASL_VISIT(MapType)
+    DASL_VISIT(RecordType)
+    DASL_VISIT(AnyType)
+    DASL_VISIT(PrimType)
+    DASL_VISIT(ListPat)
+    DASL_VISIT(MapPat)
+    DASL_VISIT(RecordPat)
+    DASL_VISIT(SymbolPat)
+    DASL_VISIT(ValuePat)
+    DASL_VISIT(IfElseExpr)
+    DASL_VISIT(CaseExpr)
+    DASL_VISIT(RecordExpr)
+    DASL_VISIT(ListExpr)
+    DASL_VISIT(MapExpr)
+    DASL_VISIT(ValueExpr)
+    DASL_VISIT(SymbolExpr)
+    DASL_VISIT(CallExpr)
+    DASL_VISIT(BinOpExpr)
+    DASL_VISIT(UnOpExpr)
+    DASL_VISIT(CompoundExpr)
+    DASL_VISIT(DefSt)
+    DASL_VISIT(RecordSt)
+    DASL_VISIT(ValSt)
+    DASL_VISIT(ModuleSt)
+    DASL_VISIT(ExprSt)
+    DASL_VISIT(ForSt)
+    DASL_VISIT(Program)
+    default: return f(node);
+  }
+#undef DASL_VISIT
+}
+
+// Calls `f` with a pointer to each child of `node` that is a Type, Pat, Expr
+// or St, in the order of the flat layout (see NodeKind): the type annotation
+// first, if there is one, then the rest in source order.
+template <typename Node, typename F>
+void for_each_child(Node &node, F &&f) {
+  using P = like<PT, Node> *;
+  auto each = [&f](auto &nodes) {
+    for (auto it = nodes.begin(); it != nodes.end(); it++) f(P(*it));
+  };
+  auto pairs = [&f](auto &nodes) {
+    for (auto it = nodes.begin(); it != nodes.end(); it++) {
+      f(P(it->first));
+      f(P(it->second));
+    }
+  };
+  auto seconds = [&f](auto &nodes) {
+    for (auto it = nodes.begin(); it != nodes.end(); it++) f(P(it->second));
+  };
+  auto type = [&f](auto &n) {
+    if (n.type) f(P(n.type));
+  };
+
+  switch (node.tag) {
+    case NodeKind::LIST_PAT: {
+      auto &n = static_cast<like<ListPat, Node> &>(node);
+      type(n);
+      each(n.pats);
+      if (n.tail) f(P(n.tail));
+      break;
+    }
+    case NodeKind::MAP_PAT: {
+      auto &n = static_cast<like<MapPat, Node> &>(node);
+      type(n);
+      pairs(n.entries);
+      break;
+    }
+    case NodeKind::RECORD_PAT: {
+      auto &n = static_cast<like<RecordPat, Node> &>(node);
+      type(n);
+      seconds(n.fields);
+      break;
+    }
+    case NodeKind::SYMBOL_PAT:
+    case NodeKind::VALUE_PAT:
+      type(static_cast<like<Pat, Node> &>(node));
+      break;
+
+    case NodeKind::IF_ELSE_EXPR: {
+      auto &n = static_cast<like<IfElseExpr, Node> &>(node);
+      type(n);
+      f(P(n.cond));
+      each(n.body);
+      if (n.else_body) each(*n.else_body);
+      break;
+    }
+    case NodeKind::CASE_EXPR: {
+      auto &n = static_cast<like<CaseExpr, Node> &>(node);
+      type(n);
+      f(P(n.value));
+      pairs(n.cases);
+      break;
+    }
+    case NodeKind::RECORD_EXPR: {
+      auto &n = static_cast<like<RecordExpr, Node> &>(node);
+      type(n);
+      seconds(n.fields);
+      break;
+    }
+    case NodeKind::LIST_EXPR: {
+      auto &n = static_cast<like<ListExpr, Node> &>(node);
+      type(n);
+      each(n.values);
+      if (n.tail) f(P(n.tail));
+      break;
+    }
+    case NodeKind::MAP_EXPR: {
+      auto &n = static_cast<like<MapExpr, Node> &>(node);
+      type(n);
+      pairs(n.items);
+      break;
+    }
+    case NodeKind::VALUE_EXPR:
+    case NodeKind::SYMBOL_EXPR:
+      type(static_cast<like<Expr, Node> &>(node));
+      break;
+    case NodeKind::CALL_EXPR: {
+      auto &n = static_cast<like<CallExpr, Node> &>(node);
+      type(n);
+      each(n.args);
+      break;
+    }
+    case NodeKind::BIN_OP_EXPR: {
+      auto &n = static_cast<like<BinOpExpr, Node> &>(node);
+      type(n);
+      f(P(n.lhs));
+      f(P(n.rhs));
+      break;
+    }
+    case NodeKind::UN_OP_EXPR: {
+      auto &n = static_cast<like<UnOpExpr, Node> &>(node);
+      type(n);
+      f(P(n.value));
+      break;
+    }
+    case NodeKind::COMPOUND_EXPR: {
+      auto &n = static_cast<like<CompoundExpr, Node> &>(node);
+      type(n);
+      each(n.exprs);
+      break;
+    }
+
+    case NodeKind::DEF_ST: {
+      auto &n = static_cast<like<DefSt, Node> &>(node);
+      type(n);
+      each(n.args);
+      each(n.body);
+      break;
+    }
+    case NodeKind::RECORD_ST:
+      seconds(static_cast<like<RecordSt, Node> &>(node).fields);
+      break;
+    case NodeKind::VAL_ST:
+      f(P(static_cast<like<ValSt, Node> &>(node).expr));
+      break;
+    case NodeKind::MODULE_ST:
+      each(static_cast<like<ModuleSt, Node> &>(node).statements);
+      break;
+    case NodeKind::EXPR_ST:
+      f(P(static_cast<like<ExprSt, Node> &>(node).expr));
+      break;
+    case NodeKind::FOR_ST: {
+      auto &n = static_cast<like<ForSt, Node> &>(node);
+      f(P(n.pattern));
+      f(P(n.container));
+      break;
+    }
+    case NodeKind::PROGRAM:
+      each(static_cast<like<Program, Node> &>(node).statements);
+      break;
+
+    // Types only refer to records by name.
+    default:
+      break;
+  }
+}
+
+// Calls `enter` on every node of the tree under `root` before its children,
+// and `leave` after them. If `enter` returns false the children are skipped,
+// but `leave` is still called. Both get a PT, or a const PT if `root` is
+// const. Recurses once per level, so use walk_iterative on trees of
+// unbounded depth.
+template <typename Node, typename Enter, typename Leave>
+void walk(Node *root, Enter &&enter, Leave &&leave) {
+  using P = like<PT, Node> *;
+  P node = root;
+  if (enter(*node)) for_each_child(*node, [&](P child) { walk(child, enter, leave); });
+  leave(*node);
+}
+
+template <typename Node, typename Enter>
+void walk(Node *root, Enter &&enter) {
+  walk(root, enter, [](auto &) {});
+}
+
+// Same as walk, visiting the nodes in the same order, but with a stack on
+// the heap, so the depth of the tree is not limited by the native stack.
+template <typename Node, typename Enter, typename Leave>
+void walk_iterative(Node *root, Enter &&enter, Leave &&leave) {
+  using P = like<PT, Node> *;
+  struct Frame {
+    P node;
+    bool entered;
+  };
+  vector<Frame> stack{ { root, false } };
+  vector<P> children;
+  while (!stack.empty()) {
+    Frame &top = stack.back();
+    P node = top.node;
+    if (top.entered) {
+      stack.pop_back();
+      leave(*node);
+      continue;
+    }
+    top.entered = true;
+    if (!enter(*node)) continue;
+
+    children.clear();
+    for_each_child(*node, [&children](P child) { children.push_back(child); });
+    for (auto it = children.rbegin(); it != children.rend(); it++)
+      stack.push_back({ *it, false });
+  }
+}
+
+template <typename Node, typename Enter>
+void walk_iterative(Node *root, Enter &&enter) {
+  walk_iterative(root, enter, [](auto &) {});
+}
+
+} // namespace dasl::pt
+
+#endif // VISIT_HXX
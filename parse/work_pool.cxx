@@ -0,0 +1,91 @@
+#include "work_pool.hxx"
+
+namespace dasl {
+
+WorkPool::WorkPool(size_t threads) {
+  if (threads == 0) threads = 1;
+  for (size_t i = 0; i < threads; i++)
+    queues.push_back(std::make_unique<Queue>());
+  for (size_t i = 0; i < threads; i++)
+    workers.emplace_back(&WorkPool::run, this, i);
+}
+
+WorkPool::~WorkPool() {
+  wait();
+  {
+    std::lock_guard<std::mutex> guard(state_lock);
+    stopping = true;
+  }
+  work_ready.notify_all();
+  for (auto it = workers.begin(); it != workers.end(); it++)
+    it->join();
+}
+
+void WorkPool::submit(std::function<void()> task) {
+  Queue &q = *queues[next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+  unfinished.fetch_add(1);
+  {
+    // Bumping `queued` under the state lock means a worker that just found
+    // nothing to do cannot miss this wakeup. It is counted before the push so
+    // it can never be decremented below zero by a worker that wins the race.
+    std::lock_guard<std::mutex> guard(state_lock);
+    queued.fetch_add(1);
+  }
+  {
+    std::lock_guard<std::mutex> guard(q.lock);
+    q.tasks.push_back(std::move(task));
+  }
+  work_ready.notify_one();
+}
+
+bool WorkPool::take(size_t self, std::function<void()> &task) {
+  {
+    Queue &own = *queues[self];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < queues.size(); i++) {
+    Queue &victim = *queues[(self + i) % queues.size()];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void WorkPool::run(size_t self) {
+  std::function<void()> task;
+  while (true) {
+    if (take(self, task)) {
+      queued.fetch_sub(1);
+      task();
+      task = nullptr;
+
+      if (unfinished.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> guard(state_lock);
+        all_done.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> guard(state_lock);
+    work_ready.wait(guard, [this] { return stopping || queued.load() > 0; });
+    if (stopping && queued.load() == 0) return;
+  }
+}
+
+void WorkPool::wait() {
+  std::unique_lock<std::mutex> guard(state_lock);
+  all_done.wait(guard, [this] { return unfinished.load() == 0; });
+}
+
+} // namespace dasl
@@ -0,0 +1,56 @@
+#ifndef WORK_POOL_HXX
+#define WORK_POOL_HXX
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dasl {
+
+// Fixed size thread pool with one task deque per worker. submit() deals tasks
+// out round robin; a worker takes from the back of its own deque and, once
+// that is empty, steals from the front of the others', so uneven task sizes
+// (say, one huge file among many small ones) still keep every core busy.
+class WorkPool {
+  struct Queue {
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+
+  std::mutex state_lock;
+  std::condition_variable work_ready;
+  std::condition_variable all_done;
+  // Tasks sitting in a deque, and tasks submitted but not yet finished.
+  std::atomic<size_t> queued { 0 };
+  std::atomic<size_t> unfinished { 0 };
+  std::atomic<size_t> next_queue { 0 };
+  bool stopping = false;
+
+  bool take(size_t self, std::function<void()> &task);
+  void run(size_t self);
+
+ public:
+  explicit WorkPool(size_t threads = std::thread::hardware_concurrency());
+  WorkPool(const WorkPool &) = delete;
+  WorkPool &operator=(const WorkPool &) = delete;
+  ~WorkPool();
+
+  size_t size() const { return workers.size(); }
+
+  void submit(std::function<void()> task);
+
+  // Blocks until every task submitted so far has finished.
+  void wait();
+};
+
+} // namespace dasl
+
+#endif // WORK_POOL_HXX